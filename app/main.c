@@ -3,6 +3,16 @@
 int main() {
     printf("Starting main process");
 
+    int fd = open("/hello.txt");
+    if (fd >= 0) {
+        char* data = mmap(fd, 0, 4096, PROT_READ, MAP_PRIVATE);
+        if (data != MAP_FAILED) {
+            printf(data);
+            munmap(data, 4096);
+        }
+        close(fd);
+    }
+
     int pid = fork();
     int flag = 0;
 
@@ -15,7 +25,7 @@ int main() {
         printf("Hello from parent process");
 
         int status;
-        int child_pid = wait(&status);
+        int child_pid = waitpid(pid, &status, 0);
 
         if (child_pid > 0) {
             printf("Child process exited");
@@ -25,7 +35,10 @@ int main() {
     }
 
     printf("Main process exiting");
-    while(1) {}
+    while(1) {
+        timespec_t idle = {1, 0};
+        nanosleep(&idle, 0);
+    }
 
     return 0;
 }
@@ -36,5 +36,161 @@ void exit(int status) {
 }
 
 int wait(int* status) {
-    return syscall(SYS_WAIT, (int)status, 0, 0, 0, 0);
+    return syscall(SYS_WAIT, (int)status, (int)TIMEOUT_INFINITE, 0, 0, 0);
+}
+
+int wait_timeout(int* status, unsigned int timeout_ms) {
+    return syscall(SYS_WAIT, (int)status, (int)timeout_ms, 0, 0, 0);
+}
+
+int open(const char* path) {
+    return syscall(SYS_OPEN, (int)path, 0, 0, 0, 0);
+}
+
+int close(int fd) {
+    return syscall(SYS_CLOSE, fd, 0, 0, 0, 0);
+}
+
+int read(int fd, void* buf, unsigned int size) {
+    return syscall(SYS_READ, fd, (int)buf, (int)size, 0, 0);
+}
+
+void* mmap(int fd, unsigned int offset, unsigned int length, int prot, int flags) {
+    return (void*)syscall(SYS_MMAP, fd, (int)offset, (int)length, prot, flags);
+}
+
+int munmap(void* addr, unsigned int length) {
+    return syscall(SYS_MUNMAP, (int)addr, (int)length, 0, 0, 0);
+}
+
+int madvise(void* addr, unsigned int length, int advice) {
+    return syscall(SYS_MADVISE, (int)addr, (int)length, advice, 0, 0);
+}
+
+int memstat(int pid, memstat_t* stats) {
+    return syscall(SYS_MEMSTAT, pid, (int)stats, 0, 0, 0);
+}
+
+int ksmstat(ksmstat_t* stats) {
+    return syscall(SYS_KSMSTAT, (int)stats, 0, 0, 0, 0);
+}
+
+int shm_create(const char* name, unsigned int size) {
+    return syscall(SYS_SHM_CREATE, (int)name, (int)size, 0, 0, 0);
+}
+
+int shm_open(const char* name) {
+    return syscall(SYS_SHM_OPEN, (int)name, 0, 0, 0, 0);
+}
+
+void* shm_map(int id, int prot) {
+    return (void*)syscall(SYS_SHM_MAP, id, prot, 0, 0, 0);
+}
+
+int shm_unlink(const char* name) {
+    return syscall(SYS_SHM_UNLINK, (int)name, 0, 0, 0, 0);
+}
+
+int template_create(void) {
+    return syscall(SYS_TEMPLATE_CREATE, 0, 0, 0, 0, 0);
+}
+
+int template_spawn(int id) {
+    return syscall(SYS_TEMPLATE_SPAWN, id, 0, 0, 0, 0);
+}
+
+int template_destroy(int id) {
+    return syscall(SYS_TEMPLATE_DESTROY, id, 0, 0, 0, 0);
+}
+
+int uffd_create(void) {
+    return syscall(SYS_UFFD_CREATE, 0, 0, 0, 0, 0);
+}
+
+int uffd_register(int uffd, void* addr, unsigned int length) {
+    return syscall(SYS_UFFD_REGISTER, uffd, (int)addr, (int)length, 0, 0);
+}
+
+int uffd_read(int uffd, uffd_msg_t* msg) {
+    return syscall(SYS_UFFD_READ, uffd, (int)msg, 0, 0, 0);
+}
+
+int uffd_copy(int uffd, void* dst, const void* src, unsigned int length) {
+    return syscall(SYS_UFFD_COPY, uffd, (int)dst, (int)src, (int)length, 0);
+}
+
+int uffd_zeropage(int uffd, void* dst, unsigned int length) {
+    return syscall(SYS_UFFD_ZEROPAGE, uffd, (int)dst, (int)length, 0, 0);
+}
+
+int uffd_close(int uffd) {
+    return syscall(SYS_UFFD_CLOSE, uffd, 0, 0, 0, 0);
+}
+
+int softdirty_clear(int pid) {
+    return syscall(SYS_SOFTDIRTY_CLEAR, pid, 0, 0, 0, 0);
+}
+
+int softdirty_get(int pid, void* start, unsigned int* addrs, unsigned int max) {
+    return syscall(SYS_SOFTDIRTY_GET, pid, (int)start, (int)addrs, (int)max, 0);
+}
+
+int checkpoint(int pid, int parent) {
+    return syscall(SYS_CHECKPOINT, pid, parent, 0, 0, 0);
+}
+
+int restore(int id) {
+    return syscall(SYS_RESTORE, id, 0, 0, 0, 0);
+}
+
+int checkpoint_drop(int id) {
+    return syscall(SYS_CHECKPOINT_DROP, id, 0, 0, 0, 0);
+}
+
+int page_colouring(int enable) {
+    return syscall(SYS_PAGE_COLOURING, enable, 0, 0, 0, 0);
+}
+
+int nice(int inc) {
+    return syscall(SYS_NICE, inc, 0, 0, 0, 0);
+}
+
+int setpriority(int pid, int nice) {
+    return syscall(SYS_SETPRIORITY, pid, nice, 0, 0, 0);
+}
+
+int sched_setattr(int pid, unsigned int runtime_ms, unsigned int deadline_ms, unsigned int period_ms) {
+    return syscall(SYS_SCHED_SETATTR, pid, (int)runtime_ms, (int)deadline_ms, (int)period_ms, 0);
+}
+
+int sched_yield(void) {
+    return syscall(SYS_SCHED_YIELD, 0, 0, 0, 0, 0);
+}
+
+int tickstat(tickstat_t* stats, int mode) {
+    return syscall(SYS_TICKSTAT, (int)stats, mode, 0, 0, 0);
+}
+
+int clock_gettime(int clock_id, timespec_t* ts) {
+    return syscall(SYS_CLOCK_GETTIME, clock_id, (int)ts, 0, 0, 0);
+}
+
+int nanosleep(const timespec_t* req, timespec_t* rem) {
+    return syscall(SYS_NANOSLEEP, (int)req, (int)rem, 0, 0, 0);
+}
+
+int waitpid(int pid, int* status, int options) {
+    return syscall(SYS_WAITPID, pid, (int)status, options, 0, 0);
+}
+
+int thread_create(void (*fn)(void*), void* stack_top, void* arg) {
+    return syscall(SYS_THREAD_CREATE, (int)fn, (int)stack_top, (int)arg, 0, 0);
+}
+
+int futex(int* uaddr, int op, int val, unsigned int val2, int* uaddr2) {
+    return syscall(SYS_FUTEX, (int)uaddr, op, val, (int)val2, (int)uaddr2);
+}
+
+int set_thread_area(void* base) {
+    return syscall(SYS_SET_THREAD_AREA, (int)base, 0, 0, 0, 0);
 }
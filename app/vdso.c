@@ -0,0 +1,55 @@
+#include <lib/div64.h>
+#include <lib/sys/syscall.h>
+#include <lib/sys/vdso.h>
+
+static const volatile vdso_data_t* const vdso = (const volatile vdso_data_t*)VDSO_ADDRESS;
+
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+static uint32_t read_begin(void) {
+    uint32_t seq;
+    do {
+        seq = vdso->seq;
+    } while (seq & 1);
+    __asm__ volatile("" : : : "memory");
+    return seq;
+}
+
+static int read_retry(uint32_t seq) {
+    __asm__ volatile("" : : : "memory");
+    return vdso->seq != seq;
+}
+
+int vdso_clock_gettime(int clock_id, timespec_t* ts) {
+    if (clock_id != CLOCK_MONOTONIC && clock_id != CLOCK_REALTIME) {
+        return clock_gettime(clock_id, ts);
+    }
+
+    uint64_t ns;
+    uint32_t seq;
+    do {
+        seq = read_begin();
+        ns = vdso->base_ns;
+        if (vdso->mult) {
+            ns += vdso_cycles_to_ns(rdtsc() - vdso->base_cycles, vdso->mult, vdso->shift);
+        }
+        if (clock_id == CLOCK_REALTIME) {
+            ns += vdso->realtime_offset_ns;
+        }
+    } while (read_retry(seq));
+
+    ts->tv_sec = (uint32_t)div_u64_rem(ns, NSEC_PER_SEC, &ts->tv_nsec);
+    return 0;
+}
+
+int getpid(void) {
+    return vdso->pid;
+}
+
+int getcpu(void) {
+    return vdso->cpu;
+}
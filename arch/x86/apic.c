@@ -0,0 +1,153 @@
+#include "arch/x86/apic.h"
+#include "arch/x86/idt.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/msr.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/timer.h"
+#include "arch/x86/tsc.h"
+#include "lib/log.h"
+#include "mem/paging.h"
+#include <stddef.h>
+
+/*
+ * Local APIC timer. It is calibrated against one PIT tick at boot and then
+ * replaces the PIT as the scheduler's clock event device. With TSC-deadline
+ * support the one-shot is an absolute TSC value written to an MSR, otherwise
+ * the APIC's own down-counter runs in one-shot or periodic mode. Either way
+ * reprogramming is a register write instead of three PIT port writes.
+ */
+
+static volatile uint32_t* apic_regs = NULL;
+static uint64_t tsc_deadline = 0;
+
+static uint32_t apic_read(uint32_t reg) { return apic_regs[reg / sizeof(uint32_t)]; }
+
+static void apic_write(uint32_t reg, uint32_t value) { apic_regs[reg / sizeof(uint32_t)] = value; }
+
+static void apic_eoi(void) { apic_write(APIC_REG_EOI, 0); }
+
+static void apic_periodic(void);
+static void apic_oneshot(uint32_t counts);
+static uint32_t apic_remaining(void);
+static void tsc_deadline_oneshot(uint32_t counts);
+static uint32_t tsc_deadline_remaining(void);
+
+static clock_event_t apic_clock_event = {
+    .name = "local APIC",
+    .max_counts = 0xFFFFFFFF,
+    .periodic = apic_periodic,
+    .oneshot = apic_oneshot,
+    .remaining = apic_remaining,
+    .acknowledge = apic_eoi,
+};
+
+static clock_event_t tsc_deadline_clock_event = {
+    .name = "local APIC (TSC-deadline)",
+    .max_counts = 0xFFFFFFFF,
+    .periodic = NULL,
+    .oneshot = tsc_deadline_oneshot,
+    .remaining = tsc_deadline_remaining,
+    .acknowledge = apic_eoi,
+};
+
+static void apic_periodic(void) {
+  apic_write(APIC_REG_LVT_TIMER, APIC_TIMER_INT_IDX | APIC_TIMER_PERIODIC);
+  apic_write(APIC_REG_TIMER_INITIAL, apic_clock_event.counts_per_tick);
+}
+
+static void apic_oneshot(uint32_t counts) {
+  apic_write(APIC_REG_LVT_TIMER, APIC_TIMER_INT_IDX | APIC_TIMER_ONESHOT);
+  apic_write(APIC_REG_TIMER_INITIAL, counts);
+}
+
+static uint32_t apic_remaining(void) { return apic_read(APIC_REG_TIMER_CURRENT); }
+
+static void tsc_deadline_oneshot(uint32_t counts) {
+  tsc_deadline = rdtsc() + counts;
+  wrmsr(MSR_TSC_DEADLINE, tsc_deadline);
+}
+
+static uint32_t tsc_deadline_remaining(void) {
+  uint64_t now = rdtsc();
+  return now >= tsc_deadline ? 0 : (uint32_t)(tsc_deadline - now);
+}
+
+static void apic_timer_handler(cpu_state_t* s, idt_info_t i, stack_state_t* e) {
+  (void)s;
+  (void)i;
+  (void)e;
+
+  timer_interrupt();
+}
+
+static void apic_spurious_handler(cpu_state_t* s, idt_info_t i, stack_state_t* e) {
+  (void)s;
+  (void)i;
+  (void)e;
+}
+
+/* Counts one PIT tick with the APIC timer masked and free-running; the TSC is sampled over the same window. */
+static void calibrate(uint32_t* apic_per_tick, uint32_t* tsc_per_tick) {
+  apic_write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+  apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_ONESHOT);
+
+  uint32_t eflags = interrupt_save();
+  apic_write(APIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+  uint64_t tsc_start = rdtsc();
+  pit_delay(PIT_COUNTS_PER_TICK);
+  uint32_t current = apic_read(APIC_REG_TIMER_CURRENT);
+  uint64_t tsc_end = rdtsc();
+  interrupt_restore(eflags);
+
+  apic_write(APIC_REG_TIMER_INITIAL, 0);
+  *apic_per_tick = 0xFFFFFFFF - current;
+  *tsc_per_tick = (uint32_t)(tsc_end - tsc_start);
+}
+
+/* Takes the scheduler tick over from the PIT. Returns false if there is no usable local APIC. */
+bool apic_timer_init(void) {
+  uint32_t eax, ebx, ecx, edx;
+  cpuid(CPUID_FEATURES, &eax, &ebx, &ecx, &edx);
+  if (!(edx & CPUID_EDX_APIC)) {
+    LOG_INFO("No local APIC, the PIT keeps the tick");
+    return false;
+  }
+
+  uint32_t base = (uint32_t)rdmsr(MSR_APIC_BASE);
+  wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+
+  uint32_t regs = map_kernel_mmio(base & APIC_BASE_ADDRESS_MASK);
+  if (regs == 0) {
+    return false;
+  }
+  apic_regs = (volatile uint32_t*)regs;
+
+  register_interrupt_handler(APIC_TIMER_INT_IDX, apic_timer_handler);
+  register_interrupt_handler(APIC_SPURIOUS_INT_IDX, apic_spurious_handler);
+  apic_write(APIC_REG_SPURIOUS, APIC_SPURIOUS_ENABLE | APIC_SPURIOUS_INT_IDX);
+
+  uint32_t apic_per_tick, tsc_per_tick;
+  calibrate(&apic_per_tick, &tsc_per_tick);
+  if (apic_per_tick == 0) {
+    LOG_ERROR("Local APIC timer did not count during calibration, the PIT keeps the tick");
+    return false;
+  }
+
+  LOG_INFO("Local APIC %d (version 0x%x) at 0x%x: %d timer counts and %d TSC cycles per %dms tick",
+           apic_read(APIC_REG_ID) >> 24, apic_read(APIC_REG_VERSION) & 0xFF, base & APIC_BASE_ADDRESS_MASK,
+           apic_per_tick, tsc_per_tick, PIT_TICK_MS);
+
+  clock_event_t* dev = &apic_clock_event;
+  apic_clock_event.counts_per_tick = apic_per_tick;
+  if ((ecx & CPUID_ECX_TSC_DEADLINE) && tsc_per_tick > 0) {
+    dev = &tsc_deadline_clock_event;
+    dev->counts_per_tick = tsc_per_tick;
+    apic_write(APIC_REG_LVT_TIMER, APIC_TIMER_INT_IDX | APIC_TIMER_TSC_DEADLINE);
+  }
+
+  uint32_t eflags = interrupt_save();
+  pit_stop();
+  timer_set_device(dev);
+  interrupt_restore(eflags);
+  return true;
+}
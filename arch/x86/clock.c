@@ -0,0 +1,122 @@
+#include "arch/x86/clock.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/msr.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/rtc.h"
+#include "arch/x86/timer.h"
+#include "arch/x86/tsc.h"
+#include "lib/div64.h"
+#include "lib/log.h"
+#include "lib/sys/errno.h"
+#include "lib/sys/time.h"
+#include "lib/sys/vdso.h"
+#include "mem/vdso.h"
+#include <stdbool.h>
+
+/*
+ * Monotonic nanosecond clock read from the TSC. Cycles are converted with a
+ * fixed-point multiply, ns = cycles * mult >> shift, calibrated once against
+ * the PIT. The timer interrupt folds the cycles since the last resync into
+ * base_ns so the delta that has to be scaled on a read stays small.
+ * CLOCK_REALTIME is the monotonic clock plus the CMOS time read at boot.
+ * Every resync is also published to the vDSO page for user-mode readers.
+ */
+
+static bool tsc_usable = false;
+static uint32_t tsc_khz = 0;
+static uint32_t mult = 0;
+static uint32_t shift = 0;
+static uint64_t base_cycles = 0;
+static uint64_t base_ns = 0;
+static uint64_t realtime_offset_ns = 0;
+
+static uint64_t cycles_to_ns(uint64_t cycles) { return vdso_cycles_to_ns(cycles, mult, shift); }
+
+static uint32_t calibrate_khz(void) {
+  uint32_t eflags = interrupt_save();
+  uint64_t start = rdtsc();
+  pit_delay(CLOCK_CALIBRATION_COUNTS);
+  uint64_t cycles = rdtsc() - start;
+  interrupt_restore(eflags);
+
+  return (uint32_t)div_u64_rem(cycles, CLOCK_CALIBRATION_MS, NULL);
+}
+
+/* Picks the largest shift that still keeps mult, the nanoseconds per cycle scaled by 2^shift, in 32 bits. */
+static void compute_mult_shift(uint32_t khz) {
+  for (shift = 32; shift > 0; shift--) {
+    uint64_t scaled = div_u64_rem((uint64_t)1000000 << shift, khz, NULL);
+    if (scaled <= 0xFFFFFFFF) {
+      mult = (uint32_t)scaled;
+      return;
+    }
+  }
+  mult = 1000000 / khz;
+}
+
+void clock_init(void) {
+  uint32_t eax, ebx, ecx, edx;
+  cpuid(CPUID_FEATURES, &eax, &ebx, &ecx, &edx);
+
+  if (edx & CPUID_EDX_TSC) {
+    tsc_khz = calibrate_khz();
+    tsc_usable = tsc_khz > 0;
+  }
+
+  if (tsc_usable) {
+    compute_mult_shift(tsc_khz);
+    base_cycles = rdtsc();
+    LOG_INFO("Clocksource: TSC at %d kHz (mult %d, shift %d)", tsc_khz, mult, shift);
+  } else {
+    LOG_INFO("Clocksource: no usable TSC, falling back to %dms timer ticks", PIT_TICK_MS);
+  }
+
+  uint32_t seconds = rtc_read_seconds();
+  realtime_offset_ns = (uint64_t)seconds * NSEC_PER_SEC - clock_monotonic_ns();
+  vdso_set_realtime_offset(realtime_offset_ns);
+  clock_resync();
+  LOG_INFO("Clocksource: CMOS time is %d seconds since the epoch", seconds);
+}
+
+/* Called from the timer interrupt to move the conversion base forward. */
+void clock_resync(void) {
+  if (!tsc_usable) {
+    vdso_update_clock(0, clock_monotonic_ns(), 0, 0);
+    return;
+  }
+
+  uint32_t eflags = interrupt_save();
+  uint64_t now = rdtsc();
+  base_ns += cycles_to_ns(now - base_cycles);
+  base_cycles = now;
+  vdso_update_clock(base_cycles, base_ns, mult, shift);
+  interrupt_restore(eflags);
+}
+
+uint64_t clock_monotonic_ns(void) {
+  if (!tsc_usable) {
+    return (uint64_t)timer_ticks() * PIT_TICK_MS * 1000000;
+  }
+
+  uint32_t eflags = interrupt_save();
+  uint64_t ns = base_ns + cycles_to_ns(rdtsc() - base_cycles);
+  interrupt_restore(eflags);
+  return ns;
+}
+
+uint64_t clock_realtime_ns(void) { return clock_monotonic_ns() + realtime_offset_ns; }
+
+int clock_get_ns(uint32_t clock_id, uint64_t* ns) {
+  switch (clock_id) {
+  case CLOCK_REALTIME:
+    *ns = clock_realtime_ns();
+    return 0;
+  case CLOCK_MONOTONIC:
+    *ns = clock_monotonic_ns();
+    return 0;
+  default:
+    return -EINVAL;
+  }
+}
+
+uint32_t clock_tsc_khz(void) { return tsc_khz; }
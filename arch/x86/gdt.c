@@ -1,7 +1,7 @@
 #include "arch/x86/gdt.h"
 #include "lib/log.h"
 
-gdt_entry_t gdt_entries[6];
+gdt_entry_t gdt_entries[GDT_ENTRIES];
 gdt_ptr_t gdt_ptr;
 
 void gdt_set_gate(int num, unsigned long base, unsigned long limit, unsigned char access, unsigned char gran) {
@@ -36,11 +36,22 @@ void gdt_set_gate(int num, unsigned long base, unsigned long limit, unsigned cha
   LOG_DEBUG("\t\tLong Mode: %s", (gran & 0x20) ? "Yes" : "No");
 }
 
+/*
+ * Points the TLS descriptor at the running thread's area. Called on every
+ * context switch, so it skips gdt_set_gate's logging; the new base takes
+ * effect when %gs is next loaded.
+ */
+void gdt_set_tls_base(uint32_t base) {
+  gdt_entries[GDT_TLS_INDEX].base_low = base & 0xFFFF;
+  gdt_entries[GDT_TLS_INDEX].base_middle = (base >> 16) & 0xFF;
+  gdt_entries[GDT_TLS_INDEX].base_high = (base >> 24) & 0xFF;
+}
+
 void gdt_init(void) {
-  gdt_ptr.limit = (sizeof(gdt_entry_t) * 6) - 1;
+  gdt_ptr.limit = (sizeof(gdt_entry_t) * GDT_ENTRIES) - 1;
   gdt_ptr.base = (unsigned int)&gdt_entries;
 
-  LOG_INFO("Initializing GDT with %d entries", 6);
+  LOG_INFO("Initializing GDT with %d entries", GDT_ENTRIES);
   LOG_INFO("GDT Base: 0x%x, Limit: 0x%x", gdt_ptr.base, gdt_ptr.limit);
 
   LOG_INFO("Setting up NULL descriptor");
@@ -66,6 +77,11 @@ void gdt_init(void) {
                GDT_ACCESS_PRESENT | GDT_ACCESS_RING3 | GDT_ACCESS_DATA | GDT_ACCESS_WRITABLE,
                GDT_GRAN_4KB | GDT_GRAN_32BIT);
 
+  LOG_INFO("Setting up user TLS segment descriptor");
+  gdt_set_gate(GDT_TLS_INDEX, 0, 0xFFFFFFFF,
+               GDT_ACCESS_PRESENT | GDT_ACCESS_RING3 | GDT_ACCESS_DATA | GDT_ACCESS_WRITABLE,
+               GDT_GRAN_4KB | GDT_GRAN_32BIT);
+
   gdt_asm();
 
   LOG_INFO("GDT initialized");
@@ -61,6 +61,10 @@ DECLARE_INTERRUPT_HANDLER(45);
 DECLARE_INTERRUPT_HANDLER(46);
 DECLARE_INTERRUPT_HANDLER(47);
 
+/* Local APIC */
+DECLARE_INTERRUPT_HANDLER(48);
+DECLARE_INTERRUPT_HANDLER(255);
+
 /* System call */
 DECLARE_INTERRUPT_HANDLER(128);
 
@@ -213,6 +217,12 @@ static void create_idt_gate(uint8_t n, uint32_t handler, uint8_t type, uint8_t p
   case IRQ_SECONDARY_ATA:
     LOG_DEBUG("\tCreating IDT gate: IRQ15 - Secondary ATA Hard Disk Controller (%d)", IRQ_SECONDARY_ATA);
     break;
+  case APIC_TIMER_INT_IDX:
+    LOG_DEBUG("\tCreating IDT gate: Local APIC Timer (%d)", APIC_TIMER_INT_IDX);
+    break;
+  case APIC_SPURIOUS_INT_IDX:
+    LOG_DEBUG("\tCreating IDT gate: Local APIC Spurious Interrupt (%d)", APIC_SPURIOUS_INT_IDX);
+    break;
   case SYSCALL_INT_IDX:
     LOG_DEBUG("\tCreating IDT gate: System Call Interrupt (%d)", SYSCALL_INT_IDX);
     break;
@@ -291,6 +301,10 @@ void idt_init(void) {
   CREATE_IDT_GATE(46);
   CREATE_IDT_GATE(47);
 
+  /* Local APIC */
+  CREATE_IDT_GATE(48);
+  CREATE_IDT_GATE(255);
+
   /* System call */
   create_idt_gate(SYSCALL_INT_IDX, (uint32_t)&interrupt_handler_128, IDT_TRAP_GATE_TYPE, PL3);
 
@@ -5,6 +5,7 @@
 #include "arch/x86/pit.h"
 #include "lib/log.h"
 #include "mem/process.h"
+#include "sched/sched.h"
 #include <stddef.h>
 
 static interrupt_handler_t interrupt_handlers[IDT_NUM_ENTRIES];
@@ -19,20 +20,20 @@ uint32_t register_interrupt_handler(uint32_t interrupt, interrupt_handler_t hand
   return 0;
 }
 
-void general_protection_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec) {
+void general_protection_fault_handler(cpu_state_t* state, idt_info_t info, stack_state_t* exec) {
     LOG_ERROR("General Protection Fault!");
     LOG_ERROR("Error code: 0x%x", info.error_code);
-    LOG_ERROR("EIP: 0x%x, CS: 0x%x, EFLAGS: 0x%x", exec.eip, exec.cs, exec.eflags);
+    LOG_ERROR("EIP: 0x%x, CS: 0x%x, EFLAGS: 0x%x", exec->eip, exec->cs, exec->eflags);
 
-    if ((exec.cs & 0x3) != 0 || (info.error_code & 0x1)) {
-        LOG_ERROR("ESP: 0x%x, SS: 0x%x", exec.esp, exec.ss);
+    if ((exec->cs & 0x3) != 0 || (info.error_code & 0x1)) {
+        LOG_ERROR("ESP: 0x%x, SS: 0x%x", exec->esp, exec->ss);
     }
 
     LOG_ERROR("Registers:");
     LOG_ERROR("  EAX: 0x%x, EBX: 0x%x, ECX: 0x%x, EDX: 0x%x",
-              state.eax, state.ebx, state.ecx, state.edx);
+              state->eax, state->ebx, state->ecx, state->edx);
     LOG_ERROR("  ESI: 0x%x, EDI: 0x%x, EBP: 0x%x, ESP: 0x%x",
-              state.esi, state.edi, state.ebp, state.esp);
+              state->esi, state->edi, state->ebp, state->esp);
 
     if (current_process) {
         LOG_ERROR("Current process: PID %d", current_process->pid);
@@ -51,20 +52,31 @@ void general_protection_fault_handler(cpu_state_t state, idt_info_t info, stack_
     }
 }
 
+/*
+ * Called from common_interrupt_handler with the saved registers, the vector
+ * and the CPU's frame pushed as its arguments. Under cdecl the callee owns
+ * that argument area, so state and exec are the frame interrupt_return pops
+ * and handlers are given pointers to them. A pending reschedule is only acted
+ * on when the frame returns to user mode.
+ */
 void interrupt_handler(cpu_state_t state, idt_info_t info, stack_state_t exec) {
   if (info.idt_index == SYSCALL_INT_IDX) {
     if (interrupt_handlers[info.idt_index] != NULL) {
-      interrupt_handlers[info.idt_index](state, info, exec);
+      interrupt_handlers[info.idt_index](&state, info, &exec);
     } else {
       LOG_ERROR("System call handler not registered! (interrupt 0x%x, eip: 0x%x)",
                 info.idt_index, exec.eip);
     }
   } else if (interrupt_handlers[info.idt_index] != NULL) {
-    interrupt_handlers[info.idt_index](state, info, exec);
+    interrupt_handlers[info.idt_index](&state, info, &exec);
   } else {
     LOG_ERROR("Unhandled interrupt: %x, eip: %x, cs: %x, eflags: %x",
               info.idt_index, exec.eip, exec.cs, exec.eflags);
   }
+
+  if ((exec.cs & 0x3) == 0x3) {
+    sched_return_to_user();
+  }
 }
 
 void interrupt_init(void) {
@@ -2,6 +2,7 @@ extern interrupt_handler
 extern kernel_stack
 
 global interrupt_sti
+global interrupt_return
 global interrupt_cli
 
 %macro NO_ERROR_HANDLER 1
@@ -32,6 +33,8 @@ common_interrupt_handler:
     push    esi
     push    edi
     call    interrupt_handler
+; new tasks start here from switch_stacks with a register frame built by process_prepare_iret_frame
+interrupt_return:
     pop     edi
     pop     esi
     pop     ebp
@@ -104,5 +107,9 @@ NO_ERROR_HANDLER 45
 NO_ERROR_HANDLER 46
 NO_ERROR_HANDLER 47
 
+; local apic timer and spurious vector
+NO_ERROR_HANDLER 48
+NO_ERROR_HANDLER 255
+
 ; syscall interrupt (0x80 = 128)
 NO_ERROR_HANDLER 128
@@ -65,3 +65,11 @@ void pic_mask(uint8_t mask1, uint8_t mask2) {
   outb(PIC1_PORT_B, mask1);
   outb(PIC2_PORT_B, mask2);
 }
+
+void pic_disable_irq(uint8_t irq) {
+  if (irq < 8) {
+    outb(PIC1_PORT_B, inb(PIC1_PORT_B) | (1 << irq));
+  } else {
+    outb(PIC2_PORT_B, inb(PIC2_PORT_B) | (1 << (irq - 8)));
+  }
+}
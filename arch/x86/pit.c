@@ -2,28 +2,59 @@
 #include "arch/x86/interrupt.h"
 #include "arch/x86/io.h"
 #include "arch/x86/pic.h"
+#include "arch/x86/timer.h"
 #include "lib/log.h"
-#include "mem/process.h"
 
-#define PIT_FREQUENCY 1193182
+#define PIT_PORT_B 0x61
+#define PIT_PORT_B_GATE2 0x01
+#define PIT_PORT_B_SPEAKER 0x02
+#define PIT_PORT_B_OUT2 0x20
 
-static void pit_handler(cpu_state_t s, idt_info_t i, stack_state_t e) {
+static uint32_t oneshot_counts = 0;
+
+static void program_channel0(uint8_t mode, uint16_t divider) {
+  outb(PIT_COMMAND, PIT_CMD_CHANNEL0 | PIT_CMD_LOBYTE | PIT_CMD_HIBYTE | mode);
+  outb(PIT_CHANNEL_0_DATA, (uint8_t)divider);
+  outb(PIT_CHANNEL_0_DATA, (uint8_t)(divider >> 8));
+}
+
+static void pit_periodic(void) { pit_set_interval(PIT_TICK_MS); }
+
+static void pit_oneshot(uint32_t counts) {
+  oneshot_counts = counts;
+  program_channel0(PIT_CMD_ONESHOT, (uint16_t)counts);
+}
+
+/* Counts left before the armed one-shot fires. Past zero the counter wraps and keeps going down from 0xFFFF. */
+static uint32_t pit_remaining(void) {
+  outb(PIT_COMMAND, PIT_CMD_CHANNEL0 | PIT_CMD_LATCH);
+  uint8_t low = inb(PIT_CHANNEL_0_DATA);
+  uint8_t high = inb(PIT_CHANNEL_0_DATA);
+  uint32_t count = (uint32_t)((high << 8) | low);
+  return count > oneshot_counts ? 0 : count;
+}
+
+static clock_event_t pit_clock_event = {
+    .name = "PIT",
+    .counts_per_tick = PIT_COUNTS_PER_TICK,
+    .max_counts = 0xFFFF,
+    .periodic = pit_periodic,
+    .oneshot = pit_oneshot,
+    .remaining = pit_remaining,
+    .acknowledge = pic_acknowledge,
+};
+
+static void pit_handler(cpu_state_t* s, idt_info_t i, stack_state_t* e) {
   (void)s;
   (void)i;
   (void)e;
 
-  LOG_WARN("PIT handler called");
-  schedule();
-
-  pic_acknowledge();
+  timer_interrupt();
 }
 
 void pit_init(void) {
-  uint8_t data = (1 << 5) | (1 << 4) | (1 << 2) | (1 << 1) | 0x00;
-  outb(PIT_COMMAND, data);
-
   register_interrupt_handler(PIT_INT_IDX, pit_handler);
-  pit_set_interval(10);
+  timer_set_device(&pit_clock_event);
 
   LOG_INFO("PIT initialized");
   LOG_LINE();
@@ -33,8 +64,27 @@ void pit_set_interval(uint32_t interval) {
   uint32_t frequency = 1000 / interval;
   uint16_t divider = (uint16_t)(PIT_FREQUENCY / frequency);
 
-  outb(PIT_CHANNEL_0_DATA, (uint8_t)divider);
-  outb(PIT_CHANNEL_0_DATA, (uint8_t)(divider >> 8));
+  program_channel0(PIT_CMD_SQUARE, divider);
 
   LOG_DEBUG("PIT set to %dHz", frequency);
 }
+
+/* Stops channel 0 once another device has taken over the tick. */
+void pit_stop(void) {
+  pic_disable_irq(PIT_INT_IDX - PIC1_START);
+  program_channel0(PIT_CMD_ONESHOT, 0);
+}
+
+/* Busy-waits counts PIT clocks on channel 2, which needs no interrupt; used to calibrate other clocks. */
+void pit_delay(uint16_t counts) {
+  uint8_t port_b = inb(PIT_PORT_B) & ~(PIT_PORT_B_SPEAKER | PIT_PORT_B_GATE2);
+  outb(PIT_PORT_B, port_b);
+
+  outb(PIT_COMMAND, PIT_CMD_CHANNEL2 | PIT_CMD_LOBYTE | PIT_CMD_HIBYTE | PIT_CMD_ONESHOT);
+  outb(PIT_CHANNEL_2_DATA, (uint8_t)counts);
+  outb(PIT_CHANNEL_2_DATA, (uint8_t)(counts >> 8));
+
+  outb(PIT_PORT_B, port_b | PIT_PORT_B_GATE2);
+  while (!(inb(PIT_PORT_B) & PIT_PORT_B_OUT2)) {
+  }
+}
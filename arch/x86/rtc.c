@@ -0,0 +1,81 @@
+#include "arch/x86/rtc.h"
+#include "arch/x86/io.h"
+#include <stdbool.h>
+
+typedef struct {
+  uint8_t seconds;
+  uint8_t minutes;
+  uint8_t hours;
+  uint8_t day;
+  uint8_t month;
+  uint8_t year;
+} rtc_time_t;
+
+static uint8_t cmos_read(uint8_t reg) {
+  outb(CMOS_ADDRESS, reg);
+  return inb(CMOS_DATA);
+}
+
+static void read_registers(rtc_time_t* time) {
+  while (cmos_read(CMOS_REG_STATUS_A) & CMOS_STATUS_A_UPDATING) {
+  }
+
+  time->seconds = cmos_read(CMOS_REG_SECONDS);
+  time->minutes = cmos_read(CMOS_REG_MINUTES);
+  time->hours = cmos_read(CMOS_REG_HOURS);
+  time->day = cmos_read(CMOS_REG_DAY);
+  time->month = cmos_read(CMOS_REG_MONTH);
+  time->year = cmos_read(CMOS_REG_YEAR);
+}
+
+static bool same_time(const rtc_time_t* a, const rtc_time_t* b) {
+  return a->seconds == b->seconds && a->minutes == b->minutes && a->hours == b->hours && a->day == b->day &&
+         a->month == b->month && a->year == b->year;
+}
+
+static uint8_t from_bcd(uint8_t value) { return (value & 0x0F) + (value >> 4) * 10; }
+
+/* Days since 1970-01-01 for a proleptic Gregorian date. */
+static uint32_t days_since_epoch(uint32_t year, uint32_t month, uint32_t day) {
+  if (month <= 2) {
+    year--;
+    month += 12;
+  }
+  uint32_t days = 365 * year + year / 4 - year / 100 + year / 400 + (153 * (month - 3) + 2) / 5 + day - 1;
+  return days - 719468;
+}
+
+/* Reads the CMOS clock, assumed to hold UTC, as seconds since the epoch. */
+uint32_t rtc_read_seconds(void) {
+  rtc_time_t time, check;
+
+  read_registers(&time);
+  do {
+    check = time;
+    read_registers(&time);
+  } while (!same_time(&time, &check));
+
+  uint8_t status_b = cmos_read(CMOS_REG_STATUS_B);
+  bool pm = time.hours & CMOS_HOURS_PM;
+  time.hours &= ~CMOS_HOURS_PM;
+
+  if (!(status_b & CMOS_STATUS_B_BINARY)) {
+    time.seconds = from_bcd(time.seconds);
+    time.minutes = from_bcd(time.minutes);
+    time.hours = from_bcd(time.hours);
+    time.day = from_bcd(time.day);
+    time.month = from_bcd(time.month);
+    time.year = from_bcd(time.year);
+  }
+
+  if (!(status_b & CMOS_STATUS_B_24HOUR)) {
+    time.hours %= 12;
+    if (pm) {
+      time.hours += 12;
+    }
+  }
+
+  uint32_t year = 2000 + time.year;
+  uint32_t days = days_since_epoch(year, time.month, time.day);
+  return days * 86400 + time.hours * 3600 + time.minutes * 60 + time.seconds;
+}
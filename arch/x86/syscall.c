@@ -1,13 +1,33 @@
 #include "arch/x86/syscall.h"
+#include "arch/x86/clock.h"
+#include "arch/x86/gdt.h"
 #include "arch/x86/idt.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/timer.h"
+#include "arch/x86/uaccess.h"
+#include "fs/vfs.h"
 #include "lib/log.h"
+#include "lib/div64.h"
 #include "lib/string.h"
+#include "lib/sys/errno.h"
+#include "lib/sys/futex.h"
+#include "lib/sys/time.h"
+#include "mem/checkpoint.h"
+#include "mem/ksm.h"
 #include "mem/process.h"
+#include "mem/shm.h"
+#include "mem/soft_dirty.h"
 #include "mem/paging.h"
 #include "mem/page_frame_allocator.h"
+#include "mem/swap.h"
+#include "mem/template.h"
+#include "mem/userfaultfd.h"
+#include "sched/futex.h"
+#include "sched/timer_wheel.h"
+#include "sched/wait.h"
 #include <stdarg.h>
 
-#define MAX_SYSCALLS 32
+#define MAX_SYSCALLS 64
 
 #define SYS_PRINTF 1
 #define SYS_FORK 2
@@ -23,10 +43,60 @@ void syscall_init(void) {
     register_syscall(SYS_FORK, (syscall_handler_t)sys_fork);
     register_syscall(SYS_EXIT, (syscall_handler_t)sys_exit);
     register_syscall(SYS_WAIT, (syscall_handler_t)sys_wait);
+    register_syscall(SYS_OPEN, (syscall_handler_t)sys_open);
+    register_syscall(SYS_CLOSE, (syscall_handler_t)sys_close);
+    register_syscall(SYS_READ, (syscall_handler_t)sys_read);
+    register_syscall(SYS_MMAP, (syscall_handler_t)sys_mmap);
+    register_syscall(SYS_MUNMAP, (syscall_handler_t)sys_munmap);
+    register_syscall(SYS_MADVISE, (syscall_handler_t)sys_madvise);
+    register_syscall(SYS_MEMSTAT, (syscall_handler_t)sys_memstat);
+    register_syscall(SYS_KSMSTAT, (syscall_handler_t)sys_ksmstat);
+    register_syscall(SYS_SHM_CREATE, (syscall_handler_t)sys_shm_create);
+    register_syscall(SYS_SHM_OPEN, (syscall_handler_t)sys_shm_open);
+    register_syscall(SYS_SHM_MAP, (syscall_handler_t)sys_shm_map);
+    register_syscall(SYS_SHM_UNLINK, (syscall_handler_t)sys_shm_unlink);
+    register_syscall(SYS_TEMPLATE_CREATE, (syscall_handler_t)sys_template_create);
+    register_syscall(SYS_TEMPLATE_SPAWN, (syscall_handler_t)sys_template_spawn);
+    register_syscall(SYS_TEMPLATE_DESTROY, (syscall_handler_t)sys_template_destroy);
+    register_syscall(SYS_UFFD_CREATE, (syscall_handler_t)sys_uffd_create);
+    register_syscall(SYS_UFFD_REGISTER, (syscall_handler_t)sys_uffd_register);
+    register_syscall(SYS_UFFD_READ, (syscall_handler_t)sys_uffd_read);
+    register_syscall(SYS_UFFD_COPY, (syscall_handler_t)sys_uffd_copy);
+    register_syscall(SYS_UFFD_ZEROPAGE, (syscall_handler_t)sys_uffd_zeropage);
+    register_syscall(SYS_UFFD_CLOSE, (syscall_handler_t)sys_uffd_close);
+    register_syscall(SYS_SOFTDIRTY_CLEAR, (syscall_handler_t)sys_softdirty_clear);
+    register_syscall(SYS_SOFTDIRTY_GET, (syscall_handler_t)sys_softdirty_get);
+    register_syscall(SYS_CHECKPOINT, (syscall_handler_t)sys_checkpoint);
+    register_syscall(SYS_RESTORE, (syscall_handler_t)sys_restore);
+    register_syscall(SYS_CHECKPOINT_DROP, (syscall_handler_t)sys_checkpoint_drop);
+    register_syscall(SYS_PAGE_COLOURING, (syscall_handler_t)sys_page_colouring);
+    register_syscall(SYS_NICE, (syscall_handler_t)sys_nice);
+    register_syscall(SYS_SETPRIORITY, (syscall_handler_t)sys_setpriority);
+    register_syscall(SYS_SCHED_SETATTR, (syscall_handler_t)sys_sched_setattr);
+    register_syscall(SYS_SCHED_YIELD, (syscall_handler_t)sys_sched_yield);
+    register_syscall(SYS_TICKSTAT, (syscall_handler_t)sys_tickstat);
+    register_syscall(SYS_CLOCK_GETTIME, (syscall_handler_t)sys_clock_gettime);
+    register_syscall(SYS_NANOSLEEP, (syscall_handler_t)sys_nanosleep);
+    register_syscall(SYS_WAITPID, (syscall_handler_t)sys_waitpid);
+    register_syscall(SYS_THREAD_CREATE, (syscall_handler_t)sys_thread_create);
+    register_syscall(SYS_FUTEX, (syscall_handler_t)sys_futex);
+    register_syscall(SYS_SET_THREAD_AREA, (syscall_handler_t)sys_set_thread_area);
 
     LOG_INFO("Syscall interface initialized");
 }
 
+/* Copies a NUL-terminated user string into dst, failing if it does not fit. */
+static int copy_string_from_user(char* dst, uint32_t src, uint32_t size) {
+    int len = strncpy_from_user(dst, (const char*)src, size);
+    if (len < 0) {
+        return len;
+    }
+    if ((uint32_t)len >= size) {
+        return -ENAMETOOLONG;
+    }
+    return len;
+}
+
 void register_syscall(uint32_t num, syscall_handler_t handler) {
     if (num < MAX_SYSCALLS) {
         syscall_handlers[num] = handler;
@@ -35,30 +105,33 @@ void register_syscall(uint32_t num, syscall_handler_t handler) {
     }
 }
 
-void syscall_interrupt_handler(cpu_state_t state, idt_info_t info, stack_state_t exec) {
+void syscall_interrupt_handler(cpu_state_t* state, idt_info_t info, stack_state_t* exec) {
     (void)info;
-    (void)exec;
 
-    uint32_t syscall_num = state.eax;
-    uint32_t arg1 = state.ebx;
-    uint32_t arg2 = state.ecx;
-    uint32_t arg3 = state.edx;
-    uint32_t arg4 = state.esi;
-    uint32_t arg5 = state.edi;
+    uint32_t syscall_num = state->eax;
+    uint32_t arg1 = state->ebx;
+    uint32_t arg2 = state->ecx;
+    uint32_t arg3 = state->edx;
+    uint32_t arg4 = state->esi;
+    uint32_t arg5 = state->edi;
+
+    if (current_process) {
+        process_save_user_context(current_process, state, exec);
+    }
 
     LOG_DEBUG("Syscall %d received from user mode (args: 0x%x, 0x%x, 0x%x, 0x%x, 0x%x)",
               syscall_num, arg1, arg2, arg3, arg4, arg5);
 
     if (syscall_num >= MAX_SYSCALLS || syscall_handlers[syscall_num] == NULL) {
         LOG_ERROR("Invalid syscall: %d", syscall_num);
-        state.eax = (uint32_t)-1;
+        state->eax = (uint32_t)-1;
         return;
     }
 
     uint32_t result = syscall_handlers[syscall_num](arg1, arg2, arg3, arg4, arg5);
     LOG_DEBUG("Syscall %d returning result: 0x%x\n", syscall_num, result);
 
-    state.eax = result;
+    state->eax = result;
 }
 
 uint32_t sys_printf(uint32_t fmt_ptr, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4) {
@@ -72,7 +145,12 @@ uint32_t sys_printf(uint32_t fmt_ptr, uint32_t arg1, uint32_t arg2, uint32_t arg
         return (uint32_t)-1;
     }
 
-    const char* fmt = (const char*)fmt_ptr;
+    char fmt[SYSCALL_STRING_MAX];
+    int len = strncpy_from_user(fmt, (const char*)fmt_ptr, sizeof(fmt) - 1);
+    if (len < 0) {
+        return (uint32_t)len;
+    }
+    fmt[len] = '\0';
 
     LOG_INFO("%s", fmt);
     return 1;
@@ -99,18 +177,24 @@ uint32_t sys_fork(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, ui
         return (uint32_t)-1;
     }
 
-    child->parent_pid = current_process->pid;
+    process_set_parent(child, current_process);
+    sched_init_task(child, sched_get_nice(current_process));
 
     uint32_t* child_page_dir = create_page_directory();
     if (!child_page_dir) {
         LOG_ERROR("Failed to create page directory for fork");
-        child->state = PROCESS_STATE_FREE;
+        process_free(child);
         return (uint32_t)-1;
     }
     child->context.cr3 = virt_to_phys((uint32_t)child_page_dir);
 
     child->context.stack = current_process->context.stack;
     child->context.reg = current_process->context.reg;
+    child->gs = read_gs();
+    child->tls_base = current_process->tls_base;
+
+    memcpy(child->files, current_process->files, sizeof(child->files));
+    vm_copy_areas(child, current_process);
 
     uint32_t* parent_page_dir = (uint32_t*)phys_to_virt(current_process->context.cr3);
 
@@ -119,43 +203,51 @@ uint32_t sys_fork(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, ui
             uint32_t* parent_page_table = (uint32_t*)phys_to_virt(parent_page_dir[pde_idx] & ~0xFFF);
 
             for (uint32_t pte_idx = 0; pte_idx < 1024; pte_idx++) {
+                if (is_swap_entry(parent_page_table[pte_idx]) &&
+                    swap_in(current_process, (pde_idx << 22) | (pte_idx << 12)) != VM_FAULT_HANDLED) {
+                    LOG_ERROR("Failed to swap in page for child process");
+                    process_free(child);
+                    return (uint32_t)-1;
+                }
+
                 if (parent_page_table[pte_idx] & PAGE_PRESENT) {
                     uint32_t virt_addr = (pde_idx << 22) | (pte_idx << 12);
                     uint32_t phys_addr = parent_page_table[pte_idx] & ~0xFFF;
 
-                    uint32_t child_frame = alloc_frame();
+                    /* Shared, COW and read-only pages, such as initrd frames, are never written in place. */
+                    uint32_t pte = parent_page_table[pte_idx];
+                    if ((pte & (PAGE_SHARED | PAGE_COW)) || !(pte & PAGE_RW)) {
+                        ref_frame(phys_addr);
+                        map_page((uint32_t*)child->context.cr3, virt_addr, phys_addr, pte & 0xFFF);
+                        continue;
+                    }
+
+                    /* Pin the source so reclaim cannot evict it while the copy is allocated. */
+                    ref_frame(phys_addr);
+                    uint32_t child_frame = alloc_user_frame(virt_addr);
                     if (child_frame == 0) {
+                        unref_frame(phys_addr);
                         LOG_ERROR("Failed to allocate frame for child process");
-                        child->state = PROCESS_STATE_FREE;
+                        process_free(child);
                         return (uint32_t)-1;
                     }
 
                     memcpy((void*)phys_to_virt(child_frame),
                            (void*)phys_to_virt(phys_addr),
                            FRAME_SIZE);
+                    unref_frame(phys_addr);
 
                     uint32_t flags = parent_page_table[pte_idx] & 0xFFF;
                     map_page((uint32_t*)child->context.cr3, virt_addr, child_frame, flags);
+                    swap_lru_add(child_frame);
                 }
             }
         }
     }
 
-    uintptr_t child_stack_top = (uintptr_t)child->kstack + PROCESS_KERNEL_STACK_SIZE;
-    uint32_t* child_kstack_ptr = (uint32_t*)child_stack_top;
-
-    *--child_kstack_ptr = child->context.stack.ss;
-    *--child_kstack_ptr = child->context.stack.esp;
-    *--child_kstack_ptr = child->context.stack.eflags;
-    *--child_kstack_ptr = child->context.stack.cs;
-    *--child_kstack_ptr = child->context.stack.eip;
-
     child->context.reg.eax = 0;
-    child->context.reg.esp = (uint32_t)child_kstack_ptr;
-
-    child->state = PROCESS_STATE_READY;
-    child->next_in_ready_queue = ready_queue_head;
-    ready_queue_head = child;
+    process_prepare_iret_frame(child);
+    sched_enqueue(child);
 
     LOG_INFO("Fork successful: parent PID %d -> child PID %d", current_process->pid, child->pid);
 
@@ -173,48 +265,754 @@ uint32_t sys_exit(uint32_t status, uint32_t arg2, uint32_t arg3, uint32_t arg4,
         return (uint32_t)-1;
     }
 
-    LOG_INFO("Process %d exiting with status %d", current_process->pid, status);
+    process_exit((int)status);
+
+    return 0;
+}
+
+/* Timeout in ms to scheduler ticks, rounded up; TIMEOUT_INFINITE stays as it is. */
+static uint32_t timeout_to_ticks(uint32_t timeout_ms) {
+    if (timeout_ms == TIMEOUT_INFINITE) {
+        return WAIT_FOREVER;
+    }
+    return timeout_ms / PIT_TICK_MS + (timeout_ms % PIT_TICK_MS != 0);
+}
+
+typedef struct {
+    process_t* parent;
+    uint32_t pid;
+    process_t* child;
+} wait_child_t;
+
+/* Wait condition: a matching child has exited, or there is no matching child left to wait for. */
+static bool child_exited(void* arg) {
+    wait_child_t* wait = arg;
+    wait->child = get_child_process(wait->parent, wait->pid);
+    return wait->child == NULL || process_reapable(wait->child);
+}
+
+/*
+ * Blocks until the child pid (or any child for WAIT_ANY_CHILD) exits, then
+ * reaps it. Returns its PID, -ECHILD if there is no such child, or
+ * -ETIMEDOUT once timeout_ms (0 polls once) has passed.
+ */
+static int wait_for_child(uint32_t pid, uint32_t status_ptr, uint32_t timeout_ms) {
+    if (!current_process) {
+        LOG_ERROR("Wait called with no current process");
+        return -1;
+    }
+
+    wait_child_t wait = {current_process, pid, NULL};
+    int result = wait_event(&current_process->child_exit, child_exited, &wait, timeout_to_ticks(timeout_ms));
+    if (result < 0) {
+        return result;
+    }
+
+    process_t* child = wait.child;
+    if (!child) {
+        return -ECHILD;
+    }
+
+    int exit_status = child->context.reg.eax;
+    if (status_ptr && copy_to_user((void*)status_ptr, &exit_status, sizeof(exit_status)) != 0) {
+        return -EFAULT;
+    }
+
+    uint32_t child_pid = child->pid;
+    process_free(child);
+
+    LOG_INFO("Process %d reaped child %d with status %d", current_process->pid, child_pid, exit_status);
+
+    return child_pid;
+}
+
+uint32_t sys_wait(uint32_t status_ptr, uint32_t timeout_ms, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    return (uint32_t)wait_for_child(WAIT_ANY_CHILD, status_ptr, timeout_ms);
+}
+
+uint32_t sys_waitpid(uint32_t pid, uint32_t status_ptr, uint32_t options, uint32_t arg4, uint32_t arg5) {
+    (void)arg4;
+    (void)arg5;
+
+    if (options & ~WNOHANG) {
+        return (uint32_t)-EINVAL;
+    }
+
+    int result = wait_for_child(pid, status_ptr, (options & WNOHANG) ? 0 : TIMEOUT_INFINITE);
+    return (uint32_t)(result == -ETIMEDOUT ? 0 : result);
+}
+
+/*
+ * Starts a thread of the calling process running entry(arg) on the user stack
+ * ending at stack_top. The thread is a child of the caller, which reaps it
+ * with waitpid; it must end with exit rather than return from entry.
+ */
+uint32_t sys_thread_create(uint32_t entry, uint32_t stack_top, uint32_t arg, uint32_t arg4, uint32_t arg5) {
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || entry == 0 || entry >= KERNEL_VIRTUAL_START || stack_top >= KERNEL_VIRTUAL_START) {
+        return (uint32_t)-EINVAL;
+    }
+
+    /* Return address and argument, as if entry had been called. */
+    uint32_t frame[2] = {0, arg};
+    uint32_t user_esp = (stack_top & ~0xF) - sizeof(frame);
+    if (copy_to_user((void*)user_esp, frame, sizeof(frame)) != 0) {
+        return (uint32_t)-EFAULT;
+    }
+
+    process_t* thread = create_thread(current_process, entry, user_esp);
+    if (!thread) {
+        return (uint32_t)-EAGAIN;
+    }
+    return thread->pid;
+}
+
+uint32_t sys_open(uint32_t path_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || !path_ptr) {
+        LOG_ERROR("Open called with no current process or NULL path");
+        return (uint32_t)-1;
+    }
+
+    char path[SYSCALL_STRING_MAX];
+    int len = copy_string_from_user(path, path_ptr, sizeof(path));
+    if (len < 0) {
+        return (uint32_t)len;
+    }
+
+    fs_descriptor_t desc;
+    if (open_file(path, &desc) != 0) {
+        return (uint32_t)-1;
+    }
+
+    int fd = process_install_fd(current_process, &desc);
+    if (fd < 0) {
+        close_file(&desc);
+        return (uint32_t)-1;
+    }
+
+    LOG_DEBUG("Process %d opened %s as fd %d", current_process->pid, path, fd);
+    return fd;
+}
+
+uint32_t sys_close(uint32_t fd, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        LOG_ERROR("Close called with no current process");
+        return (uint32_t)-1;
+    }
+
+    return process_close_fd(current_process, (int)fd);
+}
+
+uint32_t sys_read(uint32_t fd, uint32_t buf_ptr, uint32_t size, uint32_t arg4, uint32_t arg5) {
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || !buf_ptr) {
+        LOG_ERROR("Read called with no current process or NULL buffer");
+        return (uint32_t)-1;
+    }
+
+    fs_descriptor_t* desc = process_get_fd(current_process, (int)fd);
+    if (!desc) {
+        return (uint32_t)-1;
+    }
+
+    if (!access_ok((void*)buf_ptr, size)) {
+        return (uint32_t)-EFAULT;
+    }
+
+    char chunk[SYSCALL_READ_CHUNK];
+    uint32_t total = 0;
+
+    while (total < size) {
+        uint32_t want = size - total < sizeof(chunk) ? size - total : sizeof(chunk);
+        int bytes_read = read_file(desc, chunk, want);
+        if (bytes_read <= 0) {
+            return total > 0 ? total : (uint32_t)bytes_read;
+        }
+
+        if (copy_to_user((void*)(buf_ptr + total), chunk, bytes_read) != 0) {
+            return (uint32_t)-EFAULT;
+        }
+
+        total += bytes_read;
+        if ((uint32_t)bytes_read < want) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+uint32_t sys_mmap(uint32_t fd, uint32_t offset, uint32_t length, uint32_t prot, uint32_t flags) {
+    if (!current_process) {
+        LOG_ERROR("Mmap called with no current process");
+        return (uint32_t)MAP_FAILED;
+    }
+
+    fs_descriptor_t* desc = NULL;
+    if (!(flags & MAP_ANONYMOUS)) {
+        desc = process_get_fd(current_process, (int)fd);
+        if (!desc) {
+            return (uint32_t)MAP_FAILED;
+        }
+    }
+
+    uint32_t addr = vm_mmap(current_process, desc, offset, length, prot, flags);
+    if (addr == 0) {
+        return (uint32_t)MAP_FAILED;
+    }
+
+    return addr;
+}
+
+uint32_t sys_munmap(uint32_t addr, uint32_t length, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        LOG_ERROR("Munmap called with no current process");
+        return (uint32_t)-1;
+    }
+
+    return vm_munmap(current_process, addr, length);
+}
 
-    current_process->context.reg.eax = status;
-    current_process->state = PROCESS_STATE_TERMINATED;
+uint32_t sys_madvise(uint32_t addr, uint32_t length, uint32_t advice, uint32_t arg4, uint32_t arg5) {
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        LOG_ERROR("Madvise called with no current process");
+        return (uint32_t)-1;
+    }
+
+    return vm_madvise(current_process, addr, length, advice);
+}
+
+uint32_t sys_memstat(uint32_t pid, uint32_t stats_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || !stats_ptr) {
+        LOG_ERROR("Memstat called with no current process or NULL buffer");
+        return (uint32_t)-1;
+    }
+
+    process_t* proc = pid == 0 ? current_process : get_process_by_pid(pid);
+    if (!proc) {
+        return (uint32_t)-1;
+    }
+
+    if (copy_to_user((void*)stats_ptr, &proc->mem_stats, sizeof(memstat_t)) != 0) {
+        return (uint32_t)-EFAULT;
+    }
+    return 0;
+}
+
+uint32_t sys_ksmstat(uint32_t stats_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
 
-    schedule();
+    if (!stats_ptr) {
+        LOG_ERROR("Ksmstat called with NULL buffer");
+        return (uint32_t)-1;
+    }
 
+    ksmstat_t stats;
+    ksm_get_stats(&stats);
+    if (copy_to_user((void*)stats_ptr, &stats, sizeof(stats)) != 0) {
+        return (uint32_t)-EFAULT;
+    }
     return 0;
 }
 
-uint32_t sys_wait(uint32_t status_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+uint32_t sys_shm_create(uint32_t name_ptr, uint32_t size, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || !name_ptr) {
+        LOG_ERROR("Shm_create called with no current process or NULL name");
+        return (uint32_t)-1;
+    }
+
+    char name[SHM_NAME_MAX];
+    int len = copy_string_from_user(name, name_ptr, sizeof(name));
+    if (len < 0) {
+        return (uint32_t)len;
+    }
+
+    return (uint32_t)shm_create(name, size);
+}
+
+uint32_t sys_shm_open(uint32_t name_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
     (void)arg2;
     (void)arg3;
     (void)arg4;
     (void)arg5;
 
+    if (!current_process || !name_ptr) {
+        LOG_ERROR("Shm_open called with no current process or NULL name");
+        return (uint32_t)-1;
+    }
+
+    char name[SHM_NAME_MAX];
+    int len = copy_string_from_user(name, name_ptr, sizeof(name));
+    if (len < 0) {
+        return (uint32_t)len;
+    }
+
+    return (uint32_t)shm_open(name);
+}
+
+uint32_t sys_shm_map(uint32_t id, uint32_t prot, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
     if (!current_process) {
-        LOG_ERROR("Wait called with no current process");
+        LOG_ERROR("Shm_map called with no current process");
+        return (uint32_t)MAP_FAILED;
+    }
+
+    uint32_t addr = shm_map(current_process, (int)id, prot);
+    if (addr == 0) {
+        return (uint32_t)MAP_FAILED;
+    }
+
+    return addr;
+}
+
+uint32_t sys_shm_unlink(uint32_t name_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || !name_ptr) {
+        LOG_ERROR("Shm_unlink called with no current process or NULL name");
         return (uint32_t)-1;
     }
 
-    LOG_INFO("Process %d waiting for child", current_process->pid);
+    char name[SHM_NAME_MAX];
+    int len = copy_string_from_user(name, name_ptr, sizeof(name));
+    if (len < 0) {
+        return (uint32_t)len;
+    }
+
+    return (uint32_t)shm_unlink(name);
+}
 
-    process_t* child = get_zombie_process_for_parent(current_process->pid);
+uint32_t sys_template_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
 
-    if (!child) {
-        LOG_WARN("No terminated children found");
-        return -1;
+    if (!current_process) {
+        LOG_ERROR("Template_create called with no current process");
+        return (uint32_t)-1;
     }
 
-    int exit_status = child->context.reg.eax;
-    if (status_ptr) {
-        int* user_status = (int*)status_ptr;
-        *user_status = exit_status;
+    return (uint32_t)template_create(current_process);
+}
+
+uint32_t sys_template_spawn(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        LOG_ERROR("Template_spawn called with no current process");
+        return (uint32_t)-1;
     }
 
-    child->state = PROCESS_STATE_FREE;
-    child->pid = 0;
-    child->parent_pid = 0;
+    process_t* proc = template_spawn((int)id, current_process->pid);
+    if (!proc) {
+        return (uint32_t)-1;
+    }
 
-    LOG_INFO("Process %d reaped child %d with status %d",
-             current_process->pid, child->pid, exit_status);
+    return proc->pid;
+}
 
-    return child->pid;
+uint32_t sys_template_destroy(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    return (uint32_t)template_destroy((int)id);
+}
+
+uint32_t sys_uffd_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        LOG_ERROR("Uffd_create called with no current process");
+        return (uint32_t)-1;
+    }
+
+    return (uint32_t)uffd_create(current_process);
+}
+
+uint32_t sys_uffd_register(uint32_t id, uint32_t addr, uint32_t length, uint32_t arg4, uint32_t arg5) {
+    (void)arg4;
+    (void)arg5;
+
+    return (uint32_t)uffd_register((int)id, addr, length);
+}
+
+uint32_t sys_uffd_read(uint32_t id, uint32_t msg_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    uffd_msg_t msg;
+    int result = uffd_read((int)id, &msg);
+    if (result > 0 && copy_to_user((void*)msg_ptr, &msg, sizeof(msg)) != 0) {
+        return (uint32_t)-EFAULT;
+    }
+
+    return (uint32_t)result;
+}
+
+uint32_t sys_uffd_copy(uint32_t id, uint32_t dst, uint32_t src, uint32_t length, uint32_t arg5) {
+    (void)arg5;
+
+    return (uint32_t)uffd_copy((int)id, dst, (const void*)src, length);
+}
+
+uint32_t sys_uffd_zeropage(uint32_t id, uint32_t dst, uint32_t length, uint32_t arg4, uint32_t arg5) {
+    (void)arg4;
+    (void)arg5;
+
+    return (uint32_t)uffd_zeropage((int)id, dst, length);
+}
+
+uint32_t sys_uffd_close(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    return (uint32_t)uffd_close((int)id);
+}
+
+static process_t* process_or_self(uint32_t pid) {
+    return pid == 0 ? current_process : get_process_by_pid(pid);
+}
+
+uint32_t sys_softdirty_clear(uint32_t pid, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    process_t* proc = process_or_self(pid);
+    if (!proc) {
+        return (uint32_t)-ESRCH;
+    }
+
+    soft_dirty_clear(proc);
+    return 0;
+}
+
+uint32_t sys_softdirty_get(uint32_t pid, uint32_t start, uint32_t addrs_ptr, uint32_t max, uint32_t arg5) {
+    (void)arg5;
+
+    process_t* proc = process_or_self(pid);
+    if (!proc) {
+        return (uint32_t)-ESRCH;
+    }
+
+    if (!access_ok((void*)addrs_ptr, max * sizeof(uint32_t))) {
+        return (uint32_t)-EFAULT;
+    }
+
+    uint32_t chunk[SYSCALL_READ_CHUNK / sizeof(uint32_t)];
+    uint32_t chunk_len = sizeof(chunk) / sizeof(chunk[0]);
+    uint32_t total = 0;
+
+    while (total < max) {
+        uint32_t want = max - total < chunk_len ? max - total : chunk_len;
+        uint32_t found = soft_dirty_collect(proc, start, chunk, want);
+        if (found == 0) {
+            break;
+        }
+
+        if (copy_to_user((uint32_t*)addrs_ptr + total, chunk, found * sizeof(uint32_t)) != 0) {
+            return (uint32_t)-EFAULT;
+        }
+
+        total += found;
+        start = chunk[found - 1] + FRAME_SIZE;
+        if (found < want || start == 0) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+uint32_t sys_checkpoint(uint32_t pid, uint32_t parent, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    process_t* proc = process_or_self(pid);
+    if (!proc) {
+        return (uint32_t)-ESRCH;
+    }
+
+    return (uint32_t)checkpoint_create(proc, (int)parent);
+}
+
+uint32_t sys_restore(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        LOG_ERROR("Restore called with no current process");
+        return (uint32_t)-1;
+    }
+
+    process_t* proc = checkpoint_restore((int)id, current_process->pid);
+    if (!proc) {
+        return (uint32_t)-1;
+    }
+
+    return proc->pid;
+}
+
+uint32_t sys_checkpoint_drop(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    return (uint32_t)checkpoint_drop((int)id);
+}
+
+/* Switches colour-aware frame allocation on or off for all later faults; returns the previous mode. */
+uint32_t sys_page_colouring(uint32_t enable, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    return set_page_colouring(enable != 0) ? 1 : 0;
+}
+
+/* Adds inc to the caller's nice value, clamped to [-20, 19], and returns the new value. */
+uint32_t sys_nice(uint32_t inc, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        return (uint32_t)-ESRCH;
+    }
+
+    return (uint32_t)sched_set_nice(current_process, sched_get_nice(current_process) + (int)inc);
+}
+
+uint32_t sys_setpriority(uint32_t pid, uint32_t nice, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    process_t* proc = process_or_self(pid);
+    if (!proc || proc->state == PROCESS_STATE_TERMINATED) {
+        return (uint32_t)-ESRCH;
+    }
+
+    sched_set_nice(proc, (int)nice);
+    return 0;
+}
+
+/* Reserves runtime_ms of CPU every period_ms, to be used within deadline_ms of each period start. */
+uint32_t sys_sched_setattr(uint32_t pid, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms, uint32_t arg5) {
+    (void)arg5;
+
+    process_t* proc = process_or_self(pid);
+    if (!proc || proc->state == PROCESS_STATE_TERMINATED) {
+        return (uint32_t)-ESRCH;
+    }
+
+    return (uint32_t)sched_setattr(proc, runtime_ms, deadline_ms, period_ms);
+}
+
+uint32_t sys_sched_yield(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    sched_yield();
+    return 0;
+}
+
+/* Copies out the tick counters; mode 0 switches to the periodic PIT, 1 to tickless, anything else leaves it. */
+uint32_t sys_tickstat(uint32_t stats_ptr, uint32_t mode, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (mode == 0 || mode == 1) {
+        timer_set_tickless(mode == 1);
+    }
+
+    if (stats_ptr) {
+        tickstat_t stats;
+        timer_get_stats(&stats);
+        if (copy_to_user((void*)stats_ptr, &stats, sizeof(stats)) != 0) {
+            return (uint32_t)-EFAULT;
+        }
+    }
+    return 0;
+}
+
+uint32_t sys_clock_gettime(uint32_t clock_id, uint32_t ts_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    uint64_t ns;
+    int err = clock_get_ns(clock_id, &ns);
+    if (err) {
+        return (uint32_t)err;
+    }
+
+    timespec_t ts;
+    ts.tv_sec = (uint32_t)div_u64_rem(ns, NSEC_PER_SEC, &ts.tv_nsec);
+    if (copy_to_user((void*)ts_ptr, &ts, sizeof(ts)) != 0) {
+        return (uint32_t)-EFAULT;
+    }
+    return 0;
+}
+
+#define TICKS_PER_SEC (1000 / PIT_TICK_MS)
+#define NSEC_PER_TICK (NSEC_PER_SEC / TICKS_PER_SEC)
+
+/* Rounds up, plus one tick because the current tick is already partly over; clamped to half the tick space. */
+static uint32_t timespec_to_ticks(const timespec_t* ts) {
+    if (ts->tv_sec >= 0x7FFFFFFF / TICKS_PER_SEC) {
+        return 0x7FFFFFFF;
+    }
+    return ts->tv_sec * TICKS_PER_SEC + (ts->tv_nsec + NSEC_PER_TICK - 1) / NSEC_PER_TICK + 1;
+}
+
+uint32_t sys_nanosleep(uint32_t req_ptr, uint32_t rem_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process) {
+        return (uint32_t)-EINVAL;
+    }
+
+    timespec_t req;
+    if (copy_from_user(&req, (const void*)req_ptr, sizeof(req)) != 0) {
+        return (uint32_t)-EFAULT;
+    }
+    if (req.tv_nsec >= NSEC_PER_SEC) {
+        return (uint32_t)-EINVAL;
+    }
+    if (req.tv_sec == 0 && req.tv_nsec == 0) {
+        return 0;
+    }
+
+    /* Interrupts stay off until the timer is armed, so no wakeup or switch can see the task blocked without it. */
+    uint32_t ticks = timespec_to_ticks(&req);
+    uint32_t eflags = interrupt_save();
+    current_process->state = PROCESS_STATE_BLOCKED;
+    uint32_t left = schedule_timeout(ticks, ticks >> WHEEL_SLACK_SHIFT);
+    interrupt_restore(eflags);
+    if (left == 0) {
+        return 0;
+    }
+
+    if (rem_ptr) {
+        timespec_t rem;
+        rem.tv_sec = left / TICKS_PER_SEC;
+        rem.tv_nsec = (left % TICKS_PER_SEC) * NSEC_PER_TICK;
+        if (copy_to_user((void*)rem_ptr, &rem, sizeof(rem)) != 0) {
+            return (uint32_t)-EFAULT;
+        }
+    }
+    return (uint32_t)-EINTR;
+}
+
+/*
+ * FUTEX_WAIT sleeps while *uaddr == val for at most val2 ms (TIMEOUT_INFINITE
+ * for no limit), FUTEX_WAKE wakes up to val waiters and FUTEX_REQUEUE wakes
+ * up to val and moves up to val2 of the rest to uaddr2.
+ */
+uint32_t sys_futex(uint32_t uaddr, uint32_t op, uint32_t val, uint32_t val2, uint32_t uaddr2) {
+    if (!current_process) {
+        return (uint32_t)-EINVAL;
+    }
+
+    switch (op) {
+    case FUTEX_WAIT:
+        return (uint32_t)futex_wait(uaddr, val, timeout_to_ticks(val2));
+    case FUTEX_WAKE:
+        return (uint32_t)futex_wake(uaddr, val);
+    case FUTEX_REQUEUE:
+        return (uint32_t)futex_requeue(uaddr, val, uaddr2, val2);
+    default:
+        return (uint32_t)-EINVAL;
+    }
+}
+
+/*
+ * Sets the base of the calling thread's TLS segment and loads its selector
+ * into %gs, so thread-local data is one %gs-relative access away. Returns the
+ * selector, which stays valid in the thread across context switches.
+ */
+uint32_t sys_set_thread_area(uint32_t base, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5) {
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    if (!current_process || base >= KERNEL_VIRTUAL_START) {
+        return (uint32_t)-EINVAL;
+    }
+
+    current_process->tls_base = base;
+    gdt_set_tls_base(base);
+    write_gs(GDT_TLS_SELECTOR);
+    return GDT_TLS_SELECTOR;
 }
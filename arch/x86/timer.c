@@ -0,0 +1,152 @@
+#include "arch/x86/timer.h"
+#include "arch/x86/clock.h"
+#include "arch/x86/interrupt.h"
+#include "lib/log.h"
+#include "mem/page_idle.h"
+#include "mem/process.h"
+#include "sched/sched.h"
+#include <stddef.h>
+
+/*
+ * In tickless mode the clock event device runs in one-shot mode and is armed
+ * for the next event the scheduler asks for instead of firing every tick.
+ * Elapsed time is kept in device counts; whole ticks are handed to the
+ * scheduler when the one-shot fires and the remainder carries over.
+ */
+
+static clock_event_t* device = NULL;
+static bool tickless = true;
+static bool oneshot_armed = false;
+static uint32_t oneshot_counts = 0;
+static uint32_t elapsed_counts = 0;
+static tickstat_t tick_stats;
+
+/* Elapsed counts can reach twice an armed interval, so intervals stay below 2^31 counts. */
+static uint32_t max_ticks(void) {
+  uint32_t max_counts = device->max_counts < 0x7FFFFFFF ? device->max_counts : 0x7FFFFFFF;
+  return max_counts / device->counts_per_tick;
+}
+
+static void arm_oneshot(uint32_t ticks) {
+  oneshot_counts = ticks * device->counts_per_tick;
+  oneshot_armed = true;
+  device->oneshot(oneshot_counts);
+}
+
+static void start_device(void) {
+  elapsed_counts = 0;
+  oneshot_armed = false;
+  if (tickless || device->periodic == NULL) {
+    arm_oneshot(1);
+  } else {
+    device->periodic();
+  }
+}
+
+void timer_set_device(clock_event_t* dev) {
+  uint32_t eflags = interrupt_save();
+  device = dev;
+  start_device();
+  interrupt_restore(eflags);
+
+  LOG_INFO("Timer: ticking from %s (%s, %d counts per tick)", dev->name, tickless ? "tickless" : "periodic",
+           dev->counts_per_tick);
+}
+
+/* Called by the device's interrupt handler. */
+void timer_interrupt(void) {
+  uint32_t ticks = 1;
+  if (tickless) {
+    elapsed_counts += oneshot_armed ? oneshot_counts : device->counts_per_tick;
+    oneshot_armed = false;
+    ticks = elapsed_counts / device->counts_per_tick;
+    elapsed_counts %= device->counts_per_tick;
+  } else {
+    oneshot_armed = false;
+  }
+
+  clock_resync();
+  tick_stats.interrupts++;
+  tick_stats.ticks += ticks;
+  if (ticks > 1) {
+    tick_stats.ticks_avoided += ticks - 1;
+  }
+  if (current_process == NULL) {
+    tick_stats.idle_interrupts++;
+  }
+
+  for (uint32_t n = 0; n < ticks; n++) {
+    page_idle_tick();
+  }
+
+  /* Acknowledge first: an idle tick may switch away and not return here until the idle task runs again. */
+  device->acknowledge();
+  sched_tick(ticks);
+
+  if ((tickless || device->periodic == NULL) && !oneshot_armed) {
+    arm_oneshot(1);
+  }
+}
+
+/*
+ * Arms the one-shot for the scheduler's next event, ticks from now, or for
+ * the longest interval the device allows when ticks is 0. An armed one-shot
+ * is only replaced when the new event is sooner; the time it already ran is
+ * kept in elapsed_counts.
+ */
+void timer_request_tick(uint32_t ticks) {
+  if (!tickless || device == NULL) {
+    return;
+  }
+
+  uint32_t limit = max_ticks();
+  if (ticks == 0 || ticks > limit) {
+    ticks = limit;
+  }
+
+  uint32_t eflags = interrupt_save();
+  if (oneshot_armed) {
+    uint32_t remaining = device->remaining();
+    if (remaining > oneshot_counts) {
+      remaining = 0;
+    }
+    if (remaining <= ticks * device->counts_per_tick) {
+      interrupt_restore(eflags);
+      return;
+    }
+    elapsed_counts += oneshot_counts - remaining;
+  }
+  arm_oneshot(ticks);
+  interrupt_restore(eflags);
+}
+
+void timer_set_tickless(bool enable) {
+  uint32_t eflags = interrupt_save();
+  tickless = enable;
+  if (device != NULL) {
+    start_device();
+  }
+  interrupt_restore(eflags);
+}
+
+void timer_get_stats(tickstat_t* stats) {
+  *stats = tick_stats;
+  stats->tickless = tickless;
+}
+
+uint32_t timer_ticks(void) { return tick_stats.ticks; }
+
+/* Whole ticks the armed one-shot has already run for but not yet reported. */
+uint32_t timer_ticks_pending(void) {
+  uint32_t eflags = interrupt_save();
+  uint32_t pending = 0;
+  if (tickless && oneshot_armed) {
+    uint32_t remaining = device->remaining();
+    if (remaining > oneshot_counts) {
+      remaining = 0;
+    }
+    pending = (elapsed_counts + oneshot_counts - remaining) / device->counts_per_tick;
+  }
+  interrupt_restore(eflags);
+  return pending;
+}
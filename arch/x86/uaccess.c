@@ -0,0 +1,98 @@
+#include "arch/x86/uaccess.h"
+#include "lib/sys/errno.h"
+#include "mem/paging.h"
+
+/*
+ * Every instruction that may fault on a user address has an entry in
+ * __ex_table. page_fault_handler resumes a faulting kernel eip at its fixup,
+ * which makes the copy return -EFAULT instead of halting the machine.
+ */
+
+extern exception_table_entry_t __ex_table_start[];
+extern exception_table_entry_t __ex_table_end[];
+
+bool access_ok(const void* addr, uint32_t len) {
+  uint32_t start = (uint32_t)addr;
+  uint32_t end = start + len;
+  return end >= start && end <= KERNEL_VIRTUAL_START;
+}
+
+/* Copies whole words with rep movsl, then the tail with rep movsb. */
+static int user_copy(void* dst, const void* src, uint32_t len) {
+  uint32_t words = len / sizeof(uint32_t);
+  uint32_t tail = len % sizeof(uint32_t);
+  int err = 0;
+
+  asm volatile("1: rep movsl\n"
+               "   movl %[tail], %%ecx\n"
+               "2: rep movsb\n"
+               "   jmp 4f\n"
+               "3: movl %[efault], %[err]\n"
+               "4:\n"
+               ".pushsection __ex_table, \"a\"\n"
+               "   .long 1b, 3b\n"
+               "   .long 2b, 3b\n"
+               ".popsection\n"
+               : [err] "+r"(err), "+c"(words), "+S"(src), "+D"(dst)
+               : [tail] "r"(tail), [efault] "i"(-EFAULT)
+               : "memory", "cc");
+
+  return err;
+}
+
+int copy_from_user(void* dst, const void* src, uint32_t len) {
+  if (!access_ok(src, len)) {
+    return -EFAULT;
+  }
+  return user_copy(dst, src, len);
+}
+
+int copy_to_user(void* dst, const void* src, uint32_t len) {
+  if (!access_ok(dst, len)) {
+    return -EFAULT;
+  }
+  return user_copy(dst, src, len);
+}
+
+/* Returns the string length, or count if src has no NUL within count bytes (dst is then unterminated). */
+int strncpy_from_user(char* dst, const char* src, uint32_t count) {
+  uint32_t start = (uint32_t)src;
+  if (start >= KERNEL_VIRTUAL_START) {
+    return -EFAULT;
+  }
+  if (count > KERNEL_VIRTUAL_START - start) {
+    count = KERNEL_VIRTUAL_START - start;
+  }
+
+  uint32_t remaining = count;
+  int err = 0;
+
+  asm volatile("   testl %[rem], %[rem]\n"
+               "   jz 3f\n"
+               "1: lodsb\n"
+               "   stosb\n"
+               "   testb %%al, %%al\n"
+               "   jz 3f\n"
+               "   decl %[rem]\n"
+               "   jnz 1b\n"
+               "   jmp 3f\n"
+               "2: movl %[efault], %[err]\n"
+               "3:\n"
+               ".pushsection __ex_table, \"a\"\n"
+               "   .long 1b, 2b\n"
+               ".popsection\n"
+               : [err] "+r"(err), [rem] "+r"(remaining), "+S"(src), "+D"(dst)
+               : [efault] "i"(-EFAULT)
+               : "eax", "memory", "cc");
+
+  return err ? err : (int)(count - remaining);
+}
+
+uint32_t search_exception_table(uint32_t eip) {
+  for (exception_table_entry_t* entry = __ex_table_start; entry < __ex_table_end; entry++) {
+    if (entry->insn == eip) {
+      return entry->fixup;
+    }
+  }
+  return 0;
+}
@@ -2,6 +2,8 @@
 #include "fs/vfs.h"
 #include "lib/log.h"
 #include "lib/string.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
 #include <stddef.h>
 
 #define INITRD_MAGIC 0xBF
@@ -146,6 +148,27 @@ static int initrd_read(fs_descriptor_t* fd, void* buffer, uint32_t size) {
     return to_read;
 }
 
+static int initrd_get_page(fs_descriptor_t* fd, uint32_t offset, uint32_t* phys_addr) {
+    if (fd->inode >= initrd_header->num_files) {
+        LOG_ERROR("Invalid inode number: %d", fd->inode);
+        return -1;
+    }
+
+    initrd_file_header_t* file = &initrd_header->files[fd->inode];
+
+    if (offset & (FRAME_SIZE - 1) || offset >= file->size) {
+        return -1;
+    }
+
+    uint32_t page_phys = virt_to_phys((uint32_t)(initrd_data + file->offset + offset));
+    if (page_phys & (FRAME_SIZE - 1)) {
+        return -1;
+    }
+
+    *phys_addr = page_phys;
+    return 0;
+}
+
 static int initrd_write(fs_descriptor_t* fd, const void* buffer, uint32_t size) {
     (void)fd;
     (void)buffer;
@@ -235,6 +258,7 @@ fs_ops_t* get_initrd_ops(void) {
         .read = initrd_read,
         .write = initrd_write,
         .seek = initrd_seek,
+        .get_page = initrd_get_page,
         .readdir = initrd_readdir,
         .mkdir = initrd_mkdir,
         .rmdir = initrd_rmdir,
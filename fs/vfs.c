@@ -182,6 +182,20 @@ int seek_file(fs_descriptor_t* fd, uint32_t offset) {
     return mount->ops->seek(fd, offset);
 }
 
+int get_file_page(fs_descriptor_t* fd, uint32_t offset, uint32_t* phys_addr) {
+    mount_point_t* mount = find_mount_point_by_inode(fd->inode);
+    if (!mount) {
+        LOG_ERROR("No mount point found for file descriptor");
+        return -1;
+    }
+
+    if (!mount->ops->get_page) {
+        return -1;
+    }
+
+    return mount->ops->get_page(fd, offset, phys_addr);
+}
+
 int read_directory(fs_descriptor_t* fd, char* name, uint32_t size) {
     mount_point_t* mount = find_mount_point_by_inode(fd->inode);
     if (!mount) {
@@ -0,0 +1,27 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define APIC_REG_ID 0x020
+#define APIC_REG_VERSION 0x030
+#define APIC_REG_EOI 0x0B0
+#define APIC_REG_SPURIOUS 0x0F0
+#define APIC_REG_LVT_TIMER 0x320
+#define APIC_REG_TIMER_INITIAL 0x380
+#define APIC_REG_TIMER_CURRENT 0x390
+#define APIC_REG_TIMER_DIVIDE 0x3E0
+
+#define APIC_BASE_ENABLE 0x800
+#define APIC_BASE_ADDRESS_MASK 0xFFFFF000
+#define APIC_SPURIOUS_ENABLE 0x100
+#define APIC_LVT_MASKED 0x10000
+#define APIC_TIMER_ONESHOT 0x00000
+#define APIC_TIMER_PERIODIC 0x20000
+#define APIC_TIMER_TSC_DEADLINE 0x40000
+#define APIC_TIMER_DIVIDE_16 0x3
+
+bool apic_timer_init(void);
+
+#endif /* APIC_H */
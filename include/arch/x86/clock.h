@@ -0,0 +1,17 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/* The TSC is timed over this many PIT counts (50ms) at boot. */
+#define CLOCK_CALIBRATION_COUNTS 59659
+#define CLOCK_CALIBRATION_MS 50
+
+void clock_init(void);
+void clock_resync(void);
+uint64_t clock_monotonic_ns(void);
+uint64_t clock_realtime_ns(void);
+int clock_get_ns(uint32_t clock_id, uint64_t* ns);
+uint32_t clock_tsc_khz(void);
+
+#endif /* CLOCK_H */
@@ -19,7 +19,9 @@ struct gdt_ptr {
 } __attribute__((packed));
 typedef struct gdt_ptr gdt_ptr_t;
 
-extern gdt_entry_t gdt_entries[6];
+#define GDT_ENTRIES 7
+
+extern gdt_entry_t gdt_entries[GDT_ENTRIES];
 extern gdt_ptr_t gdt_ptr;
 
 #define GDT_NULL_INDEX 0
@@ -28,6 +30,7 @@ extern gdt_ptr_t gdt_ptr;
 #define GDT_USER_CODE_INDEX 3
 #define GDT_USER_DATA_INDEX 4
 #define GDT_TSS_INDEX 5
+#define GDT_TLS_INDEX 6
 
 #define GDT_NULL_OFFSET 0x00
 #define GDT_CODE_OFFSET 0x08
@@ -35,6 +38,10 @@ extern gdt_ptr_t gdt_ptr;
 #define GDT_USER_CODE_OFFSET 0x18
 #define GDT_USER_DATA_OFFSET 0x20
 #define GDT_TSS_OFFSET 0x28
+#define GDT_TLS_OFFSET 0x30
+
+/* Selector user code loads into %gs to reach the TLS segment of the running thread. */
+#define GDT_TLS_SELECTOR (GDT_TLS_OFFSET | 3)
 
 #define GDT_ACCESS_PRESENT 0x80
 #define GDT_ACCESS_RING0 0x00
@@ -52,6 +59,15 @@ extern gdt_ptr_t gdt_ptr;
 
 void gdt_init(void);
 void gdt_set_gate(int num, unsigned long base, unsigned long limit, unsigned char access, unsigned char gran);
+void gdt_set_tls_base(uint32_t base);
 extern void gdt_asm(void);
 
+static inline uint32_t read_gs(void) {
+  uint32_t selector;
+  asm volatile("mov %%gs, %0" : "=r"(selector));
+  return selector;
+}
+
+static inline void write_gs(uint32_t selector) { asm volatile("mov %0, %%gs" : : "r"(selector)); }
+
 #endif /* GDT_H */
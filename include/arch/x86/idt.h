@@ -90,6 +90,8 @@ void load_idt(uint32_t idt_ptr);
 #define IRQ_FPU 45
 #define IRQ_PRIMARY_ATA 46
 #define IRQ_SECONDARY_ATA 47
+#define APIC_TIMER_INT_IDX 48
+#define APIC_SPURIOUS_INT_IDX 255
 
 extern void interrupt0();  /* Divide by zero */
 extern void interrupt1();  /* Debug */
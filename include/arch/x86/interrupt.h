@@ -10,11 +10,27 @@ struct idt_info {
 } __attribute__((packed));
 typedef struct idt_info idt_info_t;
 
-typedef void (*interrupt_handler_t)(cpu_state_t state, idt_info_t info, stack_state_t exec);
+/* state and exec point into the interrupt frame, so changes to them take effect when the interrupted code resumes. */
+typedef void (*interrupt_handler_t)(cpu_state_t* state, idt_info_t info, stack_state_t* exec);
 uint32_t register_interrupt_handler(uint32_t interrupt, interrupt_handler_t handler);
 
 void interrupt_init(void);
 void interrupt_sti(void);
 void interrupt_cli(void);
 
+#define EFLAGS_IF 0x200
+
+/* Disables interrupts, returning the previous eflags for interrupt_restore. */
+static inline uint32_t interrupt_save(void) {
+  uint32_t eflags;
+  asm volatile("pushfl; popl %0; cli" : "=r"(eflags) : : "memory");
+  return eflags;
+}
+
+static inline void interrupt_restore(uint32_t eflags) {
+  if (eflags & EFLAGS_IF) {
+    asm volatile("sti" : : : "memory");
+  }
+}
+
 #endif /* INTERRUPT_H */
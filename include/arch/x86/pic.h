@@ -16,5 +16,6 @@
 void pic_init(void);
 void pic_acknowledge(void);
 void pic_mask(uint8_t mask1, uint8_t mask2);
+void pic_disable_irq(uint8_t irq);
 
 #endif /* PIC_H */
@@ -9,14 +9,22 @@
 #define PIT_COMMAND 0x43
 
 #define PIT_CMD_CHANNEL0 0x00
+#define PIT_CMD_CHANNEL2 0x80
 #define PIT_CMD_LOBYTE 0x10
 #define PIT_CMD_HIBYTE 0x20
 #define PIT_CMD_SQUARE 0x06
 #define PIT_CMD_INTERRUPT 0x0E
+#define PIT_CMD_ONESHOT 0x00
+#define PIT_CMD_LATCH 0x00
 
 #define PIT_FREQUENCY 1193182
+#define PIT_TICK_MS 10
+#define PIT_COUNTS_PER_TICK (PIT_FREQUENCY * PIT_TICK_MS / 1000)
+#define PIT_MAX_ONESHOT_TICKS (0xFFFF / PIT_COUNTS_PER_TICK)
 
 void pit_init(void);
 void pit_set_interval(uint32_t interval);
+void pit_stop(void);
+void pit_delay(uint16_t counts);
 
 #endif /* PIT_H */
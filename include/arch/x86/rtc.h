@@ -0,0 +1,25 @@
+#ifndef RTC_H
+#define RTC_H
+
+#include <stdint.h>
+
+#define CMOS_ADDRESS 0x70
+#define CMOS_DATA 0x71
+
+#define CMOS_REG_SECONDS 0x00
+#define CMOS_REG_MINUTES 0x02
+#define CMOS_REG_HOURS 0x04
+#define CMOS_REG_DAY 0x07
+#define CMOS_REG_MONTH 0x08
+#define CMOS_REG_YEAR 0x09
+#define CMOS_REG_STATUS_A 0x0A
+#define CMOS_REG_STATUS_B 0x0B
+
+#define CMOS_STATUS_A_UPDATING 0x80
+#define CMOS_STATUS_B_24HOUR 0x02
+#define CMOS_STATUS_B_BINARY 0x04
+#define CMOS_HOURS_PM 0x80
+
+uint32_t rtc_read_seconds(void);
+
+#endif /* RTC_H */
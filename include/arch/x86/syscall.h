@@ -4,20 +4,99 @@
 #include "arch/x86/interrupt.h"
 #include <stdint.h>
 
+#define SYSCALL_STRING_MAX 256
+#define SYSCALL_READ_CHUNK 512
+
 #define SYS_PRINTF 1
 #define SYS_FORK 2
 #define SYS_EXIT 3
 #define SYS_WAIT 4
+#define SYS_OPEN 5
+#define SYS_CLOSE 6
+#define SYS_READ 7
+#define SYS_MMAP 8
+#define SYS_MUNMAP 9
+#define SYS_MADVISE 10
+#define SYS_MEMSTAT 11
+#define SYS_KSMSTAT 12
+#define SYS_SHM_CREATE 13
+#define SYS_SHM_OPEN 14
+#define SYS_SHM_MAP 15
+#define SYS_SHM_UNLINK 16
+#define SYS_TEMPLATE_CREATE 17
+#define SYS_TEMPLATE_SPAWN 18
+#define SYS_TEMPLATE_DESTROY 19
+#define SYS_UFFD_CREATE 20
+#define SYS_UFFD_REGISTER 21
+#define SYS_UFFD_READ 22
+#define SYS_UFFD_COPY 23
+#define SYS_UFFD_ZEROPAGE 24
+#define SYS_UFFD_CLOSE 25
+#define SYS_SOFTDIRTY_CLEAR 26
+#define SYS_SOFTDIRTY_GET 27
+#define SYS_CHECKPOINT 28
+#define SYS_RESTORE 29
+#define SYS_CHECKPOINT_DROP 30
+#define SYS_PAGE_COLOURING 31
+#define SYS_NICE 32
+#define SYS_SETPRIORITY 33
+#define SYS_SCHED_SETATTR 34
+#define SYS_SCHED_YIELD 35
+#define SYS_TICKSTAT 36
+#define SYS_CLOCK_GETTIME 37
+#define SYS_NANOSLEEP 38
+#define SYS_WAITPID 39
+#define SYS_THREAD_CREATE 40
+#define SYS_FUTEX 41
+#define SYS_SET_THREAD_AREA 42
 
 typedef uint32_t (*syscall_handler_t)(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
 
 void syscall_init(void);
 void register_syscall(uint32_t num, syscall_handler_t handler);
-void syscall_interrupt_handler(cpu_state_t state, idt_info_t info, stack_state_t exec);
+void syscall_interrupt_handler(cpu_state_t* state, idt_info_t info, stack_state_t* exec);
 
 uint32_t sys_printf(uint32_t fmt_ptr, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
 uint32_t sys_fork(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
 uint32_t sys_exit(uint32_t status, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
-uint32_t sys_wait(uint32_t status_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_wait(uint32_t status_ptr, uint32_t timeout_ms, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_open(uint32_t path_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_close(uint32_t fd, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_read(uint32_t fd, uint32_t buf_ptr, uint32_t size, uint32_t arg4, uint32_t arg5);
+uint32_t sys_mmap(uint32_t fd, uint32_t offset, uint32_t length, uint32_t prot, uint32_t flags);
+uint32_t sys_munmap(uint32_t addr, uint32_t length, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_madvise(uint32_t addr, uint32_t length, uint32_t advice, uint32_t arg4, uint32_t arg5);
+uint32_t sys_memstat(uint32_t pid, uint32_t stats_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_ksmstat(uint32_t stats_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_shm_create(uint32_t name_ptr, uint32_t size, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_shm_open(uint32_t name_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_shm_map(uint32_t id, uint32_t prot, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_shm_unlink(uint32_t name_ptr, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_template_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_template_spawn(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_template_destroy(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_uffd_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_uffd_register(uint32_t id, uint32_t addr, uint32_t length, uint32_t arg4, uint32_t arg5);
+uint32_t sys_uffd_read(uint32_t id, uint32_t msg_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_uffd_copy(uint32_t id, uint32_t dst, uint32_t src, uint32_t length, uint32_t arg5);
+uint32_t sys_uffd_zeropage(uint32_t id, uint32_t dst, uint32_t length, uint32_t arg4, uint32_t arg5);
+uint32_t sys_uffd_close(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_softdirty_clear(uint32_t pid, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_softdirty_get(uint32_t pid, uint32_t start, uint32_t addrs_ptr, uint32_t max, uint32_t arg5);
+uint32_t sys_checkpoint(uint32_t pid, uint32_t parent, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_restore(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_checkpoint_drop(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_page_colouring(uint32_t enable, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_nice(uint32_t inc, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_setpriority(uint32_t pid, uint32_t nice, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_sched_setattr(uint32_t pid, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms, uint32_t arg5);
+uint32_t sys_sched_yield(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_tickstat(uint32_t stats_ptr, uint32_t mode, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_clock_gettime(uint32_t clock_id, uint32_t ts_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_nanosleep(uint32_t req_ptr, uint32_t rem_ptr, uint32_t arg3, uint32_t arg4, uint32_t arg5);
+uint32_t sys_waitpid(uint32_t pid, uint32_t status_ptr, uint32_t options, uint32_t arg4, uint32_t arg5);
+uint32_t sys_thread_create(uint32_t entry, uint32_t stack_top, uint32_t arg, uint32_t arg4, uint32_t arg5);
+uint32_t sys_futex(uint32_t uaddr, uint32_t op, uint32_t val, uint32_t val2, uint32_t uaddr2);
+uint32_t sys_set_thread_area(uint32_t base, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5);
 
 #endif /* SYSCALL_H */
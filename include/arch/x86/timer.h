@@ -0,0 +1,31 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "lib/sys/tickstat.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A device that can raise the scheduler tick. Counts are in the device's own
+ * units (PIT input clocks, APIC bus clocks or TSC cycles); counts_per_tick of
+ * them make one PIT_TICK_MS tick.
+ */
+typedef struct {
+  const char* name;
+  uint32_t counts_per_tick;
+  uint32_t max_counts;
+  void (*periodic)(void);
+  void (*oneshot)(uint32_t counts);
+  uint32_t (*remaining)(void);
+  void (*acknowledge)(void);
+} clock_event_t;
+
+void timer_set_device(clock_event_t* dev);
+void timer_interrupt(void);
+void timer_request_tick(uint32_t ticks);
+void timer_set_tickless(bool enable);
+void timer_get_stats(tickstat_t* stats);
+uint32_t timer_ticks(void);
+uint32_t timer_ticks_pending(void);
+
+#endif /* TIMER_H */
@@ -0,0 +1,18 @@
+#ifndef UACCESS_H
+#define UACCESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t insn;
+  uint32_t fixup;
+} exception_table_entry_t;
+
+bool access_ok(const void* addr, uint32_t len);
+int copy_from_user(void* dst, const void* src, uint32_t len);
+int copy_to_user(void* dst, const void* src, uint32_t len);
+int strncpy_from_user(char* dst, const char* src, uint32_t count);
+uint32_t search_exception_table(uint32_t eip);
+
+#endif /* UACCESS_H */
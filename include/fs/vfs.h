@@ -30,6 +30,7 @@ typedef struct {
   int (*read)(fs_descriptor_t* fd, void* buffer, uint32_t size);
   int (*write)(fs_descriptor_t* fd, const void* buffer, uint32_t size);
   int (*seek)(fs_descriptor_t* fd, uint32_t offset);
+  int (*get_page)(fs_descriptor_t* fd, uint32_t offset, uint32_t* phys_addr);
 
   int (*readdir)(fs_descriptor_t* fd, char* name, uint32_t size);
   int (*mkdir)(const char* path);
@@ -57,6 +58,7 @@ int close_file(fs_descriptor_t* fd);
 int read_file(fs_descriptor_t* fd, void* buffer, uint32_t size);
 int write_file(fs_descriptor_t* fd, const void* buffer, uint32_t size);
 int seek_file(fs_descriptor_t* fd, uint32_t offset);
+int get_file_page(fs_descriptor_t* fd, uint32_t offset, uint32_t* phys_addr);
 int read_directory(fs_descriptor_t* fd, char* name, uint32_t size);
 int create_directory(const char* path);
 int remove_directory(const char* path);
@@ -0,0 +1,20 @@
+#ifndef DIV64_H
+#define DIV64_H
+
+#include <stdint.h>
+
+/* 64-by-32-bit division without libgcc: two divl steps, high word first. */
+static inline uint64_t div_u64_rem(uint64_t dividend, uint32_t divisor, uint32_t* remainder) {
+  uint32_t high = (uint32_t)(dividend >> 32);
+  uint32_t quot_high = high / divisor;
+  uint32_t rem = high % divisor;
+  uint32_t quot_low;
+
+  asm("divl %4" : "=a"(quot_low), "=d"(rem) : "a"((uint32_t)dividend), "d"(rem), "rm"(divisor));
+  if (remainder) {
+    *remainder = rem;
+  }
+  return ((uint64_t)quot_high << 32) | quot_low;
+}
+
+#endif /* DIV64_H */
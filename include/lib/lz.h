@@ -0,0 +1,9 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdint.h>
+
+int lz_compress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap);
+int lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap);
+
+#endif /* LZ_H */
@@ -0,0 +1,9 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+/* futex operations. */
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_REQUEUE 3
+
+#endif /* FUTEX_H */
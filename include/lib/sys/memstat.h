@@ -0,0 +1,22 @@
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t resident_pages;
+  uint32_t working_set_pages;
+  uint32_t idle_pages;
+  uint32_t dirty_pages;
+  uint32_t swapped_pages;
+  uint32_t scans;
+} memstat_t;
+
+typedef struct {
+  uint32_t pages_shared;
+  uint32_t pages_sharing;
+  uint32_t pages_saved;
+  uint32_t full_scans;
+} ksmstat_t;
+
+#endif /* MEMSTAT_H */
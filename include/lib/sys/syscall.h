@@ -1,14 +1,98 @@
 #ifndef SYSCALL_H
 #define SYSCALL_H
 
+#include <lib/sys/futex.h>
+#include <lib/sys/memstat.h>
+#include <lib/sys/mman.h>
+#include <lib/sys/tickstat.h>
+#include <lib/sys/time.h>
+#include <lib/sys/userfaultfd.h>
+
 #define SYS_PRINTF 1
 #define SYS_FORK 2
 #define SYS_EXIT 3
 #define SYS_WAIT 4
+#define SYS_OPEN 5
+#define SYS_CLOSE 6
+#define SYS_READ 7
+#define SYS_MMAP 8
+#define SYS_MUNMAP 9
+#define SYS_MADVISE 10
+#define SYS_MEMSTAT 11
+#define SYS_KSMSTAT 12
+#define SYS_SHM_CREATE 13
+#define SYS_SHM_OPEN 14
+#define SYS_SHM_MAP 15
+#define SYS_SHM_UNLINK 16
+#define SYS_TEMPLATE_CREATE 17
+#define SYS_TEMPLATE_SPAWN 18
+#define SYS_TEMPLATE_DESTROY 19
+#define SYS_UFFD_CREATE 20
+#define SYS_UFFD_REGISTER 21
+#define SYS_UFFD_READ 22
+#define SYS_UFFD_COPY 23
+#define SYS_UFFD_ZEROPAGE 24
+#define SYS_UFFD_CLOSE 25
+#define SYS_SOFTDIRTY_CLEAR 26
+#define SYS_SOFTDIRTY_GET 27
+#define SYS_CHECKPOINT 28
+#define SYS_RESTORE 29
+#define SYS_CHECKPOINT_DROP 30
+#define SYS_PAGE_COLOURING 31
+#define SYS_NICE 32
+#define SYS_SETPRIORITY 33
+#define SYS_SCHED_SETATTR 34
+#define SYS_SCHED_YIELD 35
+#define SYS_TICKSTAT 36
+#define SYS_CLOCK_GETTIME 37
+#define SYS_NANOSLEEP 38
+#define SYS_WAITPID 39
+#define SYS_THREAD_CREATE 40
+#define SYS_FUTEX 41
+#define SYS_SET_THREAD_AREA 42
 
 int printf(const char* format);
 int fork(void);
 void exit(int status);
 int wait(int* status);
+int wait_timeout(int* status, unsigned int timeout_ms);
+int waitpid(int pid, int* status, int options);
+int open(const char* path);
+int close(int fd);
+int read(int fd, void* buf, unsigned int size);
+void* mmap(int fd, unsigned int offset, unsigned int length, int prot, int flags);
+int munmap(void* addr, unsigned int length);
+int madvise(void* addr, unsigned int length, int advice);
+int memstat(int pid, memstat_t* stats);
+int ksmstat(ksmstat_t* stats);
+int shm_create(const char* name, unsigned int size);
+int shm_open(const char* name);
+void* shm_map(int id, int prot);
+int shm_unlink(const char* name);
+int template_create(void);
+int template_spawn(int id);
+int template_destroy(int id);
+int uffd_create(void);
+int uffd_register(int uffd, void* addr, unsigned int length);
+int uffd_read(int uffd, uffd_msg_t* msg);
+int uffd_copy(int uffd, void* dst, const void* src, unsigned int length);
+int uffd_zeropage(int uffd, void* dst, unsigned int length);
+int uffd_close(int uffd);
+int softdirty_clear(int pid);
+int softdirty_get(int pid, void* start, unsigned int* addrs, unsigned int max);
+int checkpoint(int pid, int parent);
+int restore(int id);
+int checkpoint_drop(int id);
+int page_colouring(int enable);
+int nice(int inc);
+int setpriority(int pid, int nice);
+int sched_setattr(int pid, unsigned int runtime_ms, unsigned int deadline_ms, unsigned int period_ms);
+int sched_yield(void);
+int tickstat(tickstat_t* stats, int mode);
+int clock_gettime(int clock_id, timespec_t* ts);
+int nanosleep(const timespec_t* req, timespec_t* rem);
+int thread_create(void (*fn)(void*), void* stack_top, void* arg);
+int futex(int* uaddr, int op, int val, unsigned int val2, int* uaddr2);
+int set_thread_area(void* base);
 
 #endif /* SYSCALL_H */
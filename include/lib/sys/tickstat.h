@@ -0,0 +1,14 @@
+#ifndef TICKSTAT_H
+#define TICKSTAT_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t ticks;
+  uint32_t interrupts;
+  uint32_t ticks_avoided;
+  uint32_t idle_interrupts;
+  uint32_t tickless;
+} tickstat_t;
+
+#endif /* TICKSTAT_H */
@@ -0,0 +1,22 @@
+#ifndef TIME_H
+#define TIME_H
+
+#include <stdint.h>
+
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+#define NSEC_PER_SEC 1000000000u
+
+/* Timeout argument for a blocking call that should never time out. */
+#define TIMEOUT_INFINITE 0xFFFFFFFF
+
+/* waitpid options. */
+#define WNOHANG 1
+
+typedef struct {
+  uint32_t tv_sec;
+  uint32_t tv_nsec;
+} timespec_t;
+
+#endif /* TIME_H */
@@ -0,0 +1,15 @@
+#ifndef USERFAULTFD_H
+#define USERFAULTFD_H
+
+#include <stdint.h>
+
+#define UFFD_PAGEFAULT_FLAG_WRITE 0x1
+
+/* A missing-page fault in a registered range, reported page-aligned. */
+typedef struct {
+  uint32_t pid;
+  uint32_t address;
+  uint32_t flags;
+} uffd_msg_t;
+
+#endif /* USERFAULTFD_H */
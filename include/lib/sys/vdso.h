@@ -0,0 +1,42 @@
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <lib/sys/time.h>
+#include <stdint.h>
+
+/* Read-only page the kernel keeps mapped at the same address in every process. */
+#define VDSO_ADDRESS 0xFEC00000
+
+/*
+ * The kernel makes seq odd while it updates the page, so a reader retries
+ * until it sees the same even value before and after. With mult 0 there is no
+ * usable TSC and base_ns is only advanced on timer ticks.
+ */
+typedef struct {
+  volatile uint32_t seq;
+  uint32_t mult;
+  uint32_t shift;
+  uint64_t base_cycles;
+  uint64_t base_ns;
+  uint64_t realtime_offset_ns;
+  volatile uint32_t pid;
+  uint32_t cpu;
+} vdso_data_t;
+
+/* ns = cycles * mult >> shift, with the high word of cycles scaled separately so the products fit in 64 bits. */
+static inline uint64_t vdso_cycles_to_ns(uint64_t cycles, uint32_t mult, uint32_t shift) {
+  uint32_t high = (uint32_t)(cycles >> 32);
+  uint64_t ns = ((uint64_t)(uint32_t)cycles * mult) >> shift;
+
+  if (high) {
+    ns += ((uint64_t)high * mult) << (32 - shift);
+  }
+  return ns;
+}
+
+/* User stubs in app/vdso.c; they read the page instead of trapping into the kernel. */
+int vdso_clock_gettime(int clock_id, timespec_t* ts);
+int getpid(void);
+int getcpu(void);
+
+#endif /* VDSO_H */
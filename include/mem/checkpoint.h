@@ -0,0 +1,35 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "mem/process.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_CHECKPOINTS 16
+
+/* frame is 0 when the page did not change since the parent checkpoint. */
+typedef struct {
+  uint32_t vaddr;
+  uint32_t flags;
+  uint32_t frame;
+} checkpoint_page_t;
+
+/* Records every resident page but only stores the contents of pages dirtied since its parent. */
+typedef struct {
+  bool used;
+  int parent;
+  uint32_t pid;
+  process_context_t context;
+  uint32_t gs;
+  uint32_t tls_base;
+  vm_area_t vm_areas[MAX_VM_AREAS];
+  uint32_t num_pages;
+  uint32_t stored_pages;
+  checkpoint_page_t* pages;
+} checkpoint_t;
+
+int checkpoint_create(process_t* proc, int parent);
+process_t* checkpoint_restore(int id, uint32_t parent_pid);
+int checkpoint_drop(int id);
+
+#endif /* CHECKPOINT_H */
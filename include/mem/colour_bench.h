@@ -0,0 +1,10 @@
+#ifndef COLOUR_BENCH_H
+#define COLOUR_BENCH_H
+
+#define COLOUR_BENCH_PAGES 64
+#define COLOUR_BENCH_PASSES 32
+#define COLOUR_BENCH_LINE 64
+
+void colour_bench_run(void);
+
+#endif /* COLOUR_BENCH_H */
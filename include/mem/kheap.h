@@ -0,0 +1,10 @@
+#ifndef KHEAP_H
+#define KHEAP_H
+
+#include <stddef.h>
+
+void* kmalloc(size_t size);
+void* kzalloc(size_t size);
+void kfree(void* ptr);
+
+#endif /* KHEAP_H */
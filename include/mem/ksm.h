@@ -0,0 +1,15 @@
+#ifndef KSM_H
+#define KSM_H
+
+#include "lib/sys/memstat.h"
+#include <stdint.h>
+
+#define KSM_SCAN_INTERVAL 20
+#define KSM_PAGES_PER_PASS 64
+#define KSM_MAX_STABLE_PAGES 256
+#define KSM_MAX_UNSTABLE_PAGES 512
+
+void ksm_init(void);
+void ksm_get_stats(ksmstat_t* stats);
+
+#endif /* KSM_H */
@@ -0,0 +1,47 @@
+#ifndef MMAP_H
+#define MMAP_H
+
+#include "fs/vfs.h"
+#include "lib/sys/mman.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_VM_AREAS 16
+#define USER_MMAP_START 0x40000000
+#define USER_MMAP_END 0xBFE00000
+
+#define FAULT_AROUND_PAGES 4
+#define READAHEAD_PAGES 16
+
+struct process;
+struct shm_segment;
+struct userfaultfd;
+
+typedef struct {
+  bool used;
+  uint32_t start;
+  uint32_t end;
+  uint32_t prot;
+  uint32_t flags;
+  uint32_t offset;
+  uint32_t advice;
+  fs_descriptor_t file;
+  struct shm_segment* shm;
+  struct userfaultfd* uffd;
+} vm_area_t;
+
+typedef enum { VM_FAULT_HANDLED, VM_FAULT_NO_AREA, VM_FAULT_SIGSEGV, VM_FAULT_OOM, VM_FAULT_USERFAULT } vm_fault_t;
+
+uint32_t vm_mmap(struct process* proc, fs_descriptor_t* file, uint32_t offset, uint32_t length, uint32_t prot,
+                 uint32_t flags);
+uint32_t vm_map_shm(struct process* proc, struct shm_segment* seg, uint32_t prot);
+void vm_copy_areas(struct process* dst, struct process* src);
+int vm_share_address_space(struct process* dst, struct process* src);
+void vm_release_address_space(struct process* proc);
+int vm_munmap(struct process* proc, uint32_t addr, uint32_t length);
+int vm_madvise(struct process* proc, uint32_t addr, uint32_t length, uint32_t advice);
+int vm_split_range(struct process* proc, uint32_t addr, uint32_t end);
+vm_area_t* vm_find_area(struct process* proc, uint32_t addr);
+vm_fault_t vm_handle_fault(struct process* proc, uint32_t addr, bool present, bool write);
+
+#endif /* MMAP_H */
@@ -4,10 +4,22 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/* A 512KB 8-way L2 has 64KB per way, i.e. 16 page-sized colours. */
+#define PAGE_COLOURS 16
+
 void init_page_frame_allocator(uint32_t phys_start, uint32_t phys_end, uint32_t virt_start, uint32_t virt_end);
 uint32_t alloc_frame(void);
+uint32_t alloc_frame_coloured(uint32_t vaddr);
+bool set_page_colouring(bool enable);
+uint32_t alloc_frames(uint32_t count);
 void free_frame(uint32_t frame_addr);
+void free_frames(uint32_t frame_addr, uint32_t count);
 bool is_frame_allocated(uint32_t frame_addr);
+uint32_t get_total_frames(void);
+void reserve_frames(uint32_t phys_start, uint32_t phys_end);
+void ref_frame(uint32_t frame_addr);
+void unref_frame(uint32_t frame_addr);
+uint32_t frame_refcount(uint32_t frame_addr);
 
 uint32_t phys_to_virt(uint32_t phys_addr);
 uint32_t virt_to_phys(uint32_t virt_addr);
@@ -0,0 +1,13 @@
+#ifndef PAGE_IDLE_H
+#define PAGE_IDLE_H
+
+#include <stdint.h>
+
+#define PAGE_IDLE_SCAN_INTERVAL 100
+
+struct process;
+
+void page_idle_tick(void);
+void page_idle_scan_process(struct process* proc);
+
+#endif /* PAGE_IDLE_H */
@@ -7,6 +7,12 @@
 #define KERNEL_VIRTUAL_START 0xC0000000
 #define KERNEL_PDT_IDX (KERNEL_VIRTUAL_START >> 22)
 
+/* The top 20MB of the address space holds the vDSO and device memory instead of the physical memory map. */
+#define KERNEL_VDSO_START 0xFEC00000 /* VDSO_ADDRESS in lib/sys/vdso.h */
+#define KERNEL_VDSO_PDT_IDX (KERNEL_VDSO_START >> 22)
+#define KERNEL_MMIO_START 0xFF000000
+#define KERNEL_MMIO_PDT_IDX (KERNEL_MMIO_START >> 22)
+
 #define PAGE_PRESENT 0x1
 #define PAGE_RW 0x2
 #define PAGE_USER 0x4
@@ -16,7 +22,11 @@
 #define PAGE_DIRTY 0x40
 #define PAGE_SIZE_4MB 0x80
 #define PAGE_GLOBAL 0x100
+#define PAGE_COW 0x200
+#define PAGE_SHARED 0x400
+#define PAGE_SWAPPED 0x800
 
+#define PAGE_LARGE_SIZE 0x400000
 #define PAGE_DIRECTORY_SIZE 1024
 #define PAGE_TABLE_SIZE 1024
 #define FRAME_SIZE 4096
@@ -33,9 +43,14 @@ typedef struct kernel_meminfo kernel_meminfo_t;
 void init_paging(void);
 void enable_paging(void);
 void setup_higher_half(void);
+void map_kernel_memory(uint32_t phys_end);
+uint32_t map_kernel_mmio(uint32_t phys_addr);
+uint32_t map_vdso_page(uint32_t frame);
 uint32_t* create_page_directory(void);
 void map_page(uint32_t* page_directory, uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags);
 void unmap_page(uint32_t* page_directory, uint32_t virtual_addr);
 uint32_t get_physical_address(uint32_t* page_directory, uint32_t virtual_addr);
+uint32_t* get_page_entry(uint32_t* page_directory, uint32_t virtual_addr);
+void set_page_entry(uint32_t* page_directory, uint32_t virtual_addr, uint32_t entry);
 
 #endif /* PAGING_H */
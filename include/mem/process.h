@@ -1,9 +1,20 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
+#include "fs/vfs.h"
+#include "lib/sys/memstat.h"
+#include "mem/mmap.h"
+#include "sched/sched.h"
+#include "sched/wait.h"
+#include <stdbool.h>
 #include <stdint.h>
 
-#define MAX_PROCESSES 64
+/* PIDs are recycled from a bitmap; PID 0 is never handed out. */
+#define PID_MAX 32768
+#define PID_HASH_BUCKETS 256
+/* PCBs may take up at most 1/PROCESS_MEMORY_SHARE of physical memory. */
+#define PROCESS_MEMORY_SHARE 8
+#define PROCESS_MAX_FILES 16
 #define PROCESS_KERNEL_STACK_SIZE 4096
 #define KERNEL_CS_SELECTOR 0x08
 #define KERNEL_DS_SELECTOR 0x10
@@ -15,6 +26,9 @@
 #define USER_CODE_START 0x08048000
 #define USER_HEAP_START 0x08100000
 
+/* pid argument of get_child_process and waitpid for any child. */
+#define WAIT_ANY_CHILD 0xFFFFFFFF
+
 typedef enum {
   PROCESS_STATE_FREE,
   PROCESS_STATE_READY,
@@ -50,25 +64,66 @@ typedef struct {
   uint32_t cr3;
 } process_context_t;
 
+typedef struct {
+  bool used;
+  fs_descriptor_t desc;
+} open_file_t;
+
 typedef struct process {
   uint32_t pid;
   process_state_t state;
   process_context_t context;
   uint8_t kstack[PROCESS_KERNEL_STACK_SIZE] __attribute__((aligned(16)));
   struct process* next_in_ready_queue;
-  uint32_t parent_pid;
+  struct process* hash_next;
+  struct process* parent;
+  /* Live and exited-but-unreaped children, linked through sibling_next/sibling_prev. */
+  struct process* children;
+  struct process* zombies;
+  struct process* sibling_next;
+  struct process* sibling_prev;
+  /*
+   * Thread group leader owning the address space, the number of tasks whose
+   * PCBs still use it and the number of those that have not exited yet.
+   */
+  struct process* leader;
+  uint32_t mm_users;
+  uint32_t mm_live;
   int exit_status;
+  open_file_t files[PROCESS_MAX_FILES];
+  vm_area_t vm_areas[MAX_VM_AREAS];
+  memstat_t mem_stats;
+  uint32_t kernel_esp;
+  /* User %gs, saved when switched out, and the base of the TLS segment it may select. */
+  uint32_t gs;
+  uint32_t tls_base;
+  sched_entity_t sched;
+  wait_queue_t child_exit;
 } process_t;
 
+/* Memory areas are shared by all threads of a process and kept in the group leader. */
+static inline vm_area_t* process_vm_areas(process_t* proc) { return proc->leader->vm_areas; }
+
 void init_process_manager(void);
 process_t* allocate_pcb_and_pid(uint32_t* new_pid);
+void process_free(process_t* proc);
+void process_set_parent(process_t* proc, process_t* parent);
 process_t* create_process(void* module_data, uint32_t module_size);
 process_t* create_kernel_process(void (*entry_point)(void));
-process_t* get_zombie_process_for_parent(uint32_t parent_pid);
-void switch_to_process(process_t* next);
-void schedule(void);
+process_t* create_thread(process_t* creator, uint32_t entry, uint32_t user_esp);
+process_t* get_zombie_process_for_parent(process_t* parent);
+process_t* get_child_process(process_t* parent, uint32_t pid);
+bool process_reapable(process_t* proc);
+process_t* get_process_by_pid(uint32_t pid);
+process_t* get_next_process(uint32_t min_pid);
+void for_each_process(void (*fn)(process_t* proc));
+int process_install_fd(process_t* proc, fs_descriptor_t* desc);
+fs_descriptor_t* process_get_fd(process_t* proc, int fd);
+int process_close_fd(process_t* proc, int fd);
+void process_save_user_context(process_t* proc, cpu_state_t* regs, stack_state_t* frame);
+void process_prepare_iret_frame(process_t* proc);
+void process_exit(int status);
 
 extern process_t* current_process;
-extern process_t* ready_queue_head;
 
 #endif /* PROCESS_H */
@@ -0,0 +1,18 @@
+#ifndef RMAP_H
+#define RMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RMAP_MAX_ENTRIES 0xFFFF
+
+/* Return false to stop the walk. The visitor may unmap the mapping it is given. */
+typedef bool (*rmap_visitor_t)(uint32_t* page_dir, uint32_t vaddr, uint32_t* pte, void* arg);
+
+void rmap_init(void);
+void rmap_add(uint32_t frame, uint32_t* page_dir, uint32_t vaddr);
+void rmap_remove(uint32_t frame, uint32_t* page_dir, uint32_t vaddr);
+uint32_t rmap_count(uint32_t frame);
+uint32_t for_each_mapping(uint32_t frame, rmap_visitor_t visit, void* arg);
+
+#endif /* RMAP_H */
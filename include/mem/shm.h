@@ -0,0 +1,32 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SHM_MAX_SEGMENTS 16
+#define SHM_NAME_MAX 32
+#define SHM_MAX_SIZE (1024 * 1024)
+
+struct process;
+
+/* Named segments are referenced by their name while linked and by every memory area that maps them. */
+typedef struct shm_segment {
+  bool used;
+  bool linked;
+  char name[SHM_NAME_MAX];
+  uint32_t generation;
+  uint32_t refcount;
+  uint32_t num_pages;
+  uint32_t* frames;
+} shm_segment_t;
+
+int shm_create(const char* name, uint32_t size);
+int shm_open(const char* name);
+uint32_t shm_map(struct process* proc, int id, uint32_t prot);
+int shm_unlink(const char* name);
+void shm_get(shm_segment_t* seg);
+void shm_put(shm_segment_t* seg);
+uint32_t shm_page_frame(shm_segment_t* seg, uint32_t page_idx);
+
+#endif /* SHM_H */
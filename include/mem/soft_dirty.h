@@ -0,0 +1,13 @@
+#ifndef SOFT_DIRTY_H
+#define SOFT_DIRTY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct process;
+
+bool soft_dirty_test(uint32_t pte);
+void soft_dirty_clear(struct process* proc);
+uint32_t soft_dirty_collect(struct process* proc, uint32_t start, uint32_t* addrs, uint32_t max);
+
+#endif /* SOFT_DIRTY_H */
@@ -0,0 +1,26 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "mem/mmap.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SWAP_MAX_SLOTS 8192
+#define SWAP_MAX_COMPRESSED 2032
+#define SWAP_RECLAIM_BATCH 8
+#define SWAP_MAX_SCAN 256
+
+struct process;
+
+void swap_init(void);
+uint32_t alloc_user_frame(uint32_t vaddr);
+void swap_lru_add(uint32_t frame);
+void swap_lru_referenced(uint32_t frame);
+uint32_t swap_reclaim(uint32_t target);
+bool is_swap_entry(uint32_t pte);
+vm_fault_t swap_in(struct process* proc, uint32_t vaddr);
+void swap_free_entry(uint32_t pte);
+uint32_t swap_entry_flags(uint32_t pte);
+void swap_clear_entry_flags(uint32_t pte, uint32_t flags);
+
+#endif /* SWAP_H */
@@ -0,0 +1,22 @@
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_TEMPLATES 8
+
+struct process;
+
+/* A frozen copy of an initialized process. Instances resume at the template_create call site with 0. */
+typedef struct {
+  bool used;
+  uint32_t source_pid;
+  struct process* image;
+} process_template_t;
+
+int template_create(struct process* proc);
+struct process* template_spawn(int id, uint32_t parent_pid);
+int template_destroy(int id);
+
+#endif /* TEMPLATE_H */
@@ -0,0 +1,33 @@
+#ifndef USERFAULTFD_KERNEL_H
+#define USERFAULTFD_KERNEL_H
+
+#include "lib/sys/userfaultfd.h"
+#include "mem/process.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_USERFAULTFDS 8
+#define UFFD_MAX_EVENTS 16
+
+typedef struct {
+  uffd_msg_t msg;
+  bool delivered;
+} uffd_event_t;
+
+/* Faults of the owner's registered areas are queued here until another process resolves them. */
+typedef struct userfaultfd {
+  bool used;
+  uint32_t owner_pid;
+  uffd_event_t events[UFFD_MAX_EVENTS];
+  uint32_t num_events;
+} userfaultfd_t;
+
+int uffd_create(process_t* owner);
+int uffd_register(int id, uint32_t addr, uint32_t length);
+int uffd_read(int id, uffd_msg_t* msg);
+int uffd_copy(int id, uint32_t dst, const void* src, uint32_t length);
+int uffd_zeropage(int id, uint32_t dst, uint32_t length);
+int uffd_close(int id);
+void uffd_handle_fault(process_t* proc, uint32_t addr, bool write);
+
+#endif /* USERFAULTFD_KERNEL_H */
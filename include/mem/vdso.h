@@ -0,0 +1,11 @@
+#ifndef MEM_VDSO_H
+#define MEM_VDSO_H
+
+#include <stdint.h>
+
+void vdso_init(void);
+void vdso_update_clock(uint64_t base_cycles, uint64_t base_ns, uint32_t mult, uint32_t shift);
+void vdso_set_realtime_offset(uint64_t offset_ns);
+void vdso_set_pid(uint32_t pid);
+
+#endif /* MEM_VDSO_H */
@@ -0,0 +1,13 @@
+#ifndef SCHED_FUTEX_H
+#define SCHED_FUTEX_H
+
+#include <stdint.h>
+
+#define FUTEX_HASH_BITS 6
+#define FUTEX_HASH_BUCKETS (1 << FUTEX_HASH_BITS)
+
+int futex_wait(uint32_t uaddr, uint32_t val, uint32_t timeout);
+int futex_wake(uint32_t uaddr, uint32_t count);
+int futex_requeue(uint32_t uaddr, uint32_t wake, uint32_t uaddr2, uint32_t requeue);
+
+#endif /* SCHED_FUTEX_H */
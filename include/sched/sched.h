@@ -0,0 +1,69 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCHED_PRIORITIES 40
+#define SCHED_BITMAP_WORDS ((SCHED_PRIORITIES + 31) / 32)
+#define SCHED_NICE_MIN -20
+#define SCHED_NICE_MAX 19
+#define SCHED_NICE_TO_PRIO(nice) ((nice) + 20)
+#define SCHED_PRIO_TO_NICE(prio) ((prio) - 20)
+
+/* In PIT ticks. */
+#define SCHED_MIN_TIMESLICE 1
+#define SCHED_MAX_TIMESLICE 20
+#define SCHED_MAX_SLEEP_AVG 100
+#define SCHED_MAX_BONUS 10
+#define SCHED_INTERACTIVE_BONUS 2
+#define SCHED_STARVATION_LIMIT 100
+
+#define SCHED_NORMAL 0
+#define SCHED_DEADLINE 1
+
+/* Deadline bandwidth is runtime/period in 16.16 fixed point; 5% stays reserved for normal processes. */
+#define SCHED_DL_BW_ONE (1u << 16)
+#define SCHED_DL_MAX_BW (SCHED_DL_BW_ONE * 95 / 100)
+#define SCHED_DL_MAX_TASKS 16
+
+struct process;
+struct sched_prio_array;
+
+typedef struct {
+  int static_prio;
+  int prio;
+  uint32_t timeslice;
+  uint32_t sleep_avg;
+  uint32_t sleep_start;
+  struct sched_prio_array* array;
+
+  int policy;
+  uint32_t dl_runtime;
+  uint32_t dl_deadline;
+  uint32_t dl_period;
+  uint32_t dl_bw;
+  uint32_t dl_remaining;
+  uint32_t dl_abs_deadline;
+  uint32_t dl_next_period;
+  bool dl_throttled;
+  bool dl_queued;
+} sched_entity_t;
+
+void sched_init(void);
+void sched_init_task(struct process* proc, int nice);
+void sched_enqueue(struct process* proc);
+void sched_wake(struct process* proc);
+void sched_tick(uint32_t ticks);
+void sched_return_to_user(void);
+int sched_set_nice(struct process* proc, int nice);
+int sched_get_nice(struct process* proc);
+int sched_setattr(struct process* proc, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms);
+void sched_yield(void);
+void sched_task_exit(struct process* proc);
+uint32_t sched_context_switches(void);
+uint32_t sched_clock(void);
+void schedule(void);
+uint32_t schedule_timeout(uint32_t ticks, uint32_t slack);
+
+#endif /* SCHED_H */
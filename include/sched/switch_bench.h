@@ -0,0 +1,9 @@
+#ifndef SWITCH_BENCH_H
+#define SWITCH_BENCH_H
+
+#define SWITCH_BENCH_TASKS 2
+#define SWITCH_BENCH_ROUNDS 10000
+
+void switch_bench_run(void);
+
+#endif /* SWITCH_BENCH_H */
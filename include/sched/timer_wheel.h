@@ -0,0 +1,36 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The root level has one slot per tick; each outer level covers 64 slots of the one below. */
+#define WHEEL_ROOT_BITS 8
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_ROOT_SIZE (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SIZE (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVELS 4
+
+/* Default slack is 1/256 of the timeout, as much as a sleeper can be deferred to share a wakeup. */
+#define WHEEL_SLACK_SHIFT 8
+
+typedef void (*wheel_timer_fn_t)(void* arg);
+
+typedef struct wheel_timer {
+  struct wheel_timer* next;
+  struct wheel_timer* prev;
+  struct wheel_timer** slot;
+  uint32_t expires;
+  wheel_timer_fn_t fn;
+  void* arg;
+} wheel_timer_t;
+
+void timer_wheel_init_timer(wheel_timer_t* timer, wheel_timer_fn_t fn, void* arg);
+void timer_wheel_add(wheel_timer_t* timer, uint32_t expires, uint32_t slack);
+bool timer_wheel_cancel(wheel_timer_t* timer);
+bool timer_wheel_pending(wheel_timer_t* timer);
+void timer_wheel_advance(uint32_t now);
+uint32_t timer_wheel_next(uint32_t now);
+uint32_t timer_wheel_count(void);
+
+#endif /* TIMER_WHEEL_H */
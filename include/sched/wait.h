@@ -0,0 +1,30 @@
+#ifndef WAIT_H
+#define WAIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WAIT_FOREVER 0xFFFFFFFF
+
+struct process;
+
+/* Lives on the sleeper's kernel stack while it is queued. */
+typedef struct wait_queue_entry {
+  struct process* proc;
+  struct wait_queue_entry* next;
+  bool queued;
+} wait_queue_entry_t;
+
+typedef struct {
+  wait_queue_entry_t* head;
+  wait_queue_entry_t* tail;
+} wait_queue_t;
+
+typedef bool (*wait_cond_t)(void* arg);
+
+void wait_queue_init(wait_queue_t* wq);
+int wait_event(wait_queue_t* wq, wait_cond_t cond, void* arg, uint32_t timeout);
+void wake_up_one(wait_queue_t* wq);
+void wake_up_all(wait_queue_t* wq);
+
+#endif /* WAIT_H */
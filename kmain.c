@@ -1,3 +1,5 @@
+#include "arch/x86/apic.h"
+#include "arch/x86/clock.h"
 #include "arch/x86/gdt.h"
 #include "arch/x86/interrupt.h"
 #include "arch/x86/tss.h"
@@ -5,9 +7,16 @@
 #include "drivers/serial.h"
 #include "lib/log.h"
 #include "lib/string.h"
+#include "mem/colour_bench.h"
+#include "mem/ksm.h"
 #include "mem/page_frame_allocator.h"
 #include "mem/paging.h"
 #include "mem/process.h"
+#include "mem/rmap.h"
+#include "mem/swap.h"
+#include "mem/vdso.h"
+#include "sched/sched.h"
+#include "sched/switch_bench.h"
 #include "multiboot.h"
 #include "fs/vfs.h"
 #include "fs/initrd.h"
@@ -64,6 +73,19 @@ void test_list_directory(void) {
   LOG_LINE();
 }
 
+/* The bootloader puts modules just past the kernel, where alloc_frame would hand out frames first. */
+static void reserve_boot_modules(multiboot_info_t* mbinfo) {
+  if (mbinfo->mods_count == 0 || !(mbinfo->flags & MULTIBOOT_INFO_MODS)) {
+    return;
+  }
+
+  multiboot_module_t* modules = (multiboot_module_t*)phys_to_virt(mbinfo->mods_addr);
+  reserve_frames(mbinfo->mods_addr, mbinfo->mods_addr + mbinfo->mods_count * sizeof(multiboot_module_t));
+  for (uint32_t i = 0; i < mbinfo->mods_count; i++) {
+    reserve_frames(modules[i].mod_start, modules[i].mod_end);
+  }
+}
+
 int kmain(multiboot_info_t* mbinfo, uint32_t magic_number, kernel_meminfo_t mem) {
   log_init();
   LOG_INFO("Kernel starting...\n");
@@ -81,7 +103,19 @@ int kmain(multiboot_info_t* mbinfo, uint32_t magic_number, kernel_meminfo_t mem)
   syscall_init();
   init_page_frame_allocator(mem.kernel_physical_start, mem.kernel_physical_end, mem.kernel_virtual_start,
                             mem.kernel_virtual_end);
+  reserve_boot_modules(mbinfo);
+  swap_init();
+  rmap_init();
+  vdso_init();
+  clock_init();
+  apic_timer_init();
+#ifdef COLOUR_BENCH
+  colour_bench_run();
+#endif
   init_process_manager();
+  sched_init();
+  switch_bench_run();
+  ksm_init();
 
   init_vfs();
 
@@ -149,7 +183,7 @@ int kmain(multiboot_info_t* mbinfo, uint32_t magic_number, kernel_meminfo_t mem)
 
   schedule();
 
-  LOG_INFO("No process to schedule, halting...");
+  LOG_INFO("Nothing left to run, entering idle loop");
 
   while (1) {
     __asm__("hlt");
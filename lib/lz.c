@@ -0,0 +1,170 @@
+#include "lib/lz.h"
+#include "lib/string.h"
+
+/*
+ * LZ77 compressor using the LZ4 block layout: each sequence is a token byte
+ * (literal length << 4 | match length - LZ_MIN_MATCH), extra length bytes for
+ * nibbles of 15, the literals, then a 16-bit little-endian match offset. The
+ * last sequence carries literals only.
+ */
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 0xFFFF
+
+static uint16_t hash_table[1 << LZ_HASH_BITS];
+
+static uint32_t read32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t hash32(uint32_t value) { return (value * 2654435761u) >> (32 - LZ_HASH_BITS); }
+
+static int write_length(uint8_t* dst, uint32_t* pos, uint32_t dst_cap, uint32_t length) {
+  while (length >= 255) {
+    if (*pos >= dst_cap) {
+      return -1;
+    }
+    dst[(*pos)++] = 255;
+    length -= 255;
+  }
+  if (*pos >= dst_cap) {
+    return -1;
+  }
+  dst[(*pos)++] = (uint8_t)length;
+  return 0;
+}
+
+static int emit_sequence(uint8_t* dst, uint32_t* pos, uint32_t dst_cap, const uint8_t* literals,
+                         uint32_t literal_len, uint32_t offset, uint32_t match_len) {
+  if (*pos >= dst_cap) {
+    return -1;
+  }
+
+  uint32_t token_pos = (*pos)++;
+  uint8_t token = (literal_len >= 15 ? 15 : literal_len) << 4;
+  if (literal_len >= 15 && write_length(dst, pos, dst_cap, literal_len - 15) != 0) {
+    return -1;
+  }
+
+  if (*pos + literal_len > dst_cap) {
+    return -1;
+  }
+  memcpy(dst + *pos, literals, literal_len);
+  *pos += literal_len;
+
+  if (match_len > 0) {
+    if (*pos + 2 > dst_cap) {
+      return -1;
+    }
+    dst[(*pos)++] = offset & 0xFF;
+    dst[(*pos)++] = (offset >> 8) & 0xFF;
+
+    uint32_t extra = match_len - LZ_MIN_MATCH;
+    token |= extra >= 15 ? 15 : extra;
+    if (extra >= 15 && write_length(dst, pos, dst_cap, extra - 15) != 0) {
+      return -1;
+    }
+  }
+
+  dst[token_pos] = token;
+  return 0;
+}
+
+int lz_compress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap) {
+  uint32_t pos = 0;
+  uint32_t anchor = 0;
+  uint32_t ip = 0;
+
+  memset(hash_table, 0, sizeof(hash_table));
+
+  while (ip + LZ_MIN_MATCH <= src_len) {
+    uint32_t sequence = read32(src + ip);
+    uint32_t h = hash32(sequence);
+    uint32_t candidate = hash_table[h];
+    hash_table[h] = (uint16_t)(ip + 1);
+
+    if (candidate == 0 || ip - (candidate - 1) > LZ_MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+      ip++;
+      continue;
+    }
+
+    uint32_t match = candidate - 1;
+    uint32_t match_len = LZ_MIN_MATCH;
+    while (ip + match_len < src_len && src[match + match_len] == src[ip + match_len]) {
+      match_len++;
+    }
+
+    if (emit_sequence(dst, &pos, dst_cap, src + anchor, ip - anchor, ip - match, match_len) != 0) {
+      return -1;
+    }
+
+    ip += match_len;
+    anchor = ip;
+  }
+
+  if (emit_sequence(dst, &pos, dst_cap, src + anchor, src_len - anchor, 0, 0) != 0) {
+    return -1;
+  }
+
+  return (int)pos;
+}
+
+static int read_length(const uint8_t* src, uint32_t* pos, uint32_t src_len, uint32_t* length) {
+  uint8_t byte;
+  do {
+    if (*pos >= src_len) {
+      return -1;
+    }
+    byte = src[(*pos)++];
+    *length += byte;
+  } while (byte == 255);
+  return 0;
+}
+
+int lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap) {
+  uint32_t pos = 0;
+  uint32_t op = 0;
+
+  while (pos < src_len) {
+    uint8_t token = src[pos++];
+
+    uint32_t literal_len = token >> 4;
+    if (literal_len == 15 && read_length(src, &pos, src_len, &literal_len) != 0) {
+      return -1;
+    }
+
+    if (pos + literal_len > src_len || op + literal_len > dst_cap) {
+      return -1;
+    }
+    memcpy(dst + op, src + pos, literal_len);
+    pos += literal_len;
+    op += literal_len;
+
+    if (pos == src_len) {
+      break;
+    }
+
+    if (pos + 2 > src_len) {
+      return -1;
+    }
+    uint32_t offset = src[pos] | (src[pos + 1] << 8);
+    pos += 2;
+
+    uint32_t match_len = token & 0xF;
+    if (match_len == 15 && read_length(src, &pos, src_len, &match_len) != 0) {
+      return -1;
+    }
+    match_len += LZ_MIN_MATCH;
+
+    if (offset == 0 || offset > op || op + match_len > dst_cap) {
+      return -1;
+    }
+
+    for (uint32_t i = 0; i < match_len; i++, op++) {
+      dst[op] = dst[op - offset];
+    }
+  }
+
+  return (int)op;
+}
@@ -0,0 +1,268 @@
+#include "mem/checkpoint.h"
+#include "arch/x86/gdt.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "lib/sys/errno.h"
+#include "mem/kheap.h"
+#include "mem/mmap.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/soft_dirty.h"
+#include "mem/swap.h"
+#include <stddef.h>
+
+static checkpoint_t checkpoints[MAX_CHECKPOINTS];
+
+static checkpoint_t* checkpoint_by_id(int id) {
+  if (id < 1 || id > MAX_CHECKPOINTS || !checkpoints[id - 1].used) {
+    return NULL;
+  }
+  return &checkpoints[id - 1];
+}
+
+static uint32_t count_resident_pages(process_t* proc) {
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+  uint32_t count = 0;
+
+  for (uint32_t pde_idx = 0; pde_idx < KERNEL_PDT_IDX; pde_idx++) {
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(page_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE; pte_idx++) {
+      if (page_table[pte_idx] & (PAGE_PRESENT | PAGE_SWAPPED)) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+static void release_pages(checkpoint_t* ckpt) {
+  for (uint32_t i = 0; i < ckpt->num_pages; i++) {
+    if (ckpt->pages[i].frame) {
+      free_frame(ckpt->pages[i].frame);
+    }
+  }
+  kfree(ckpt->pages);
+  ckpt->pages = NULL;
+}
+
+static uint32_t find_page_frame(checkpoint_t* ckpt, uint32_t vaddr);
+
+/*
+ * Copies one page into the checkpoint if it is dirty relative to base or no
+ * checkpoint in base's chain holds it, e.g. because it was only read in since.
+ */
+static int save_page(checkpoint_t* ckpt, checkpoint_t* base, process_t* proc, uint32_t vaddr) {
+  uint32_t* pte = get_page_entry((uint32_t*)proc->context.cr3, vaddr);
+
+  if (base != NULL && !soft_dirty_test(*pte) && find_page_frame(base, vaddr) != 0) {
+    checkpoint_page_t* page = &ckpt->pages[ckpt->num_pages++];
+    page->vaddr = vaddr;
+    page->flags = is_swap_entry(*pte) ? swap_entry_flags(*pte) : *pte & 0xFFF;
+    page->frame = 0;
+    return 0;
+  }
+
+  if (is_swap_entry(*pte) && swap_in(proc, vaddr) != VM_FAULT_HANDLED) {
+    return -ENOMEM;
+  }
+
+  /* Pin the source so reclaim cannot evict it while the copy is allocated. */
+  uint32_t source = *pte & ~0xFFF;
+  ref_frame(source);
+  uint32_t frame = alloc_user_frame(vaddr);
+  if (frame == 0) {
+    unref_frame(source);
+    return -ENOMEM;
+  }
+  memcpy((void*)phys_to_virt(frame), (void*)phys_to_virt(source), FRAME_SIZE);
+  unref_frame(source);
+
+  checkpoint_page_t* page = &ckpt->pages[ckpt->num_pages++];
+  page->vaddr = vaddr;
+  page->flags = *pte & 0xFFF;
+  page->frame = frame;
+  ckpt->stored_pages++;
+  return 0;
+}
+
+/*
+ * Saves proc's registers, memory areas and resident pages. With a parent, only
+ * pages written since the parent was taken are copied; either way the
+ * soft-dirty bits are cleared so the next checkpoint can be incremental.
+ */
+int checkpoint_create(process_t* proc, int parent) {
+  checkpoint_t* base = NULL;
+  if (parent != 0) {
+    base = checkpoint_by_id(parent);
+    if (base == NULL || base->pid != proc->pid) {
+      return -EINVAL;
+    }
+  }
+
+  checkpoint_t* ckpt = NULL;
+  for (int i = 0; i < MAX_CHECKPOINTS; i++) {
+    if (!checkpoints[i].used) {
+      ckpt = &checkpoints[i];
+      break;
+    }
+  }
+  if (ckpt == NULL) {
+    return -ENOSPC;
+  }
+
+  uint32_t resident = count_resident_pages(proc);
+  memset(ckpt, 0, sizeof(checkpoint_t));
+  ckpt->pages = kmalloc((resident ? resident : 1) * sizeof(checkpoint_page_t));
+  if (ckpt->pages == NULL) {
+    return -ENOMEM;
+  }
+
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+  for (uint32_t pde_idx = 0; pde_idx < KERNEL_PDT_IDX; pde_idx++) {
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(page_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE; pte_idx++) {
+      if (!(page_table[pte_idx] & (PAGE_PRESENT | PAGE_SWAPPED))) {
+        continue;
+      }
+
+      /*
+       * A failed checkpoint keeps the soft-dirty bits, so an incremental one
+       * retried against the same parent still sees every page written since.
+       */
+      int result = ckpt->num_pages < resident ? save_page(ckpt, base, proc, (pde_idx << 22) | (pte_idx << 12))
+                                              : -ENOMEM;
+      if (result != 0) {
+        release_pages(ckpt);
+        return result;
+      }
+    }
+  }
+
+  ckpt->used = true;
+  ckpt->parent = parent;
+  ckpt->pid = proc->pid;
+  ckpt->context = proc->context;
+  ckpt->gs = proc->gs;
+  ckpt->tls_base = proc->tls_base;
+  if (proc == current_process) {
+    ckpt->context.reg.eax = 0;
+    ckpt->gs = read_gs();
+  }
+  memcpy(ckpt->vm_areas, process_vm_areas(proc), sizeof(ckpt->vm_areas));
+
+  soft_dirty_clear(proc);
+
+  int id = (ckpt - checkpoints) + 1;
+  LOG_INFO("checkpoint %d: PID %d, %d resident pages, %d stored (parent %d)", id, proc->pid, ckpt->num_pages,
+           ckpt->stored_pages, parent);
+  return id;
+}
+
+static uint32_t find_page_frame(checkpoint_t* ckpt, uint32_t vaddr) {
+  for (; ckpt != NULL; ckpt = ckpt->parent ? checkpoint_by_id(ckpt->parent) : NULL) {
+    for (uint32_t i = 0; i < ckpt->num_pages; i++) {
+      if (ckpt->pages[i].vaddr == vaddr) {
+        if (ckpt->pages[i].frame) {
+          return ckpt->pages[i].frame;
+        }
+        break;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+ * Rebuilds the checkpointed process as a new one with private copies of its
+ * pages. Shared memory comes back as private anonymous memory and
+ * userfaultfd registrations are dropped.
+ */
+process_t* checkpoint_restore(int id, uint32_t parent_pid) {
+  checkpoint_t* ckpt = checkpoint_by_id(id);
+  if (ckpt == NULL) {
+    return NULL;
+  }
+
+  uint32_t new_pid;
+  process_t* proc = allocate_pcb_and_pid(&new_pid);
+  if (proc == NULL) {
+    return NULL;
+  }
+
+  uint32_t* page_dir = create_page_directory();
+  if (page_dir == NULL) {
+    process_free(proc);
+    return NULL;
+  }
+  proc->context.cr3 = virt_to_phys((uint32_t)page_dir);
+
+  for (uint32_t i = 0; i < ckpt->num_pages; i++) {
+    checkpoint_page_t* page = &ckpt->pages[i];
+    uint32_t source = find_page_frame(ckpt, page->vaddr);
+    uint32_t frame = alloc_user_frame(page->vaddr);
+    if (source == 0 || frame == 0) {
+      LOG_ERROR("checkpoint %d: cannot restore page 0x%x", id, page->vaddr);
+      if (frame) {
+        free_frame(frame);
+      }
+      vm_release_address_space(proc);
+      process_free(proc);
+      return NULL;
+    }
+
+    memcpy((void*)phys_to_virt(frame), (void*)phys_to_virt(source), FRAME_SIZE);
+
+    uint32_t flags = page->flags & ~(PAGE_SHARED | PAGE_COW | PAGE_ACCESSED);
+    if (page->flags & PAGE_COW) {
+      flags |= PAGE_RW;
+    }
+    map_page((uint32_t*)proc->context.cr3, page->vaddr, frame, flags | PAGE_PRESENT | PAGE_DIRTY);
+    swap_lru_add(frame);
+  }
+
+  memcpy(proc->vm_areas, ckpt->vm_areas, sizeof(proc->vm_areas));
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    vm_area_t* area = &proc->vm_areas[i];
+    area->uffd = NULL;
+    if (area->shm) {
+      area->shm = NULL;
+      area->flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    }
+  }
+
+  proc->context.reg = ckpt->context.reg;
+  proc->context.stack = ckpt->context.stack;
+  proc->gs = ckpt->gs;
+  proc->tls_base = ckpt->tls_base;
+  process_set_parent(proc, get_process_by_pid(parent_pid));
+  process_prepare_iret_frame(proc);
+  sched_enqueue(proc);
+
+  LOG_INFO("checkpoint %d: restored as PID %d", id, proc->pid);
+  return proc;
+}
+
+int checkpoint_drop(int id) {
+  checkpoint_t* ckpt = checkpoint_by_id(id);
+  if (ckpt == NULL) {
+    return -EINVAL;
+  }
+
+  for (int i = 0; i < MAX_CHECKPOINTS; i++) {
+    if (checkpoints[i].used && checkpoints[i].parent == id) {
+      return -EBUSY;
+    }
+  }
+
+  release_pages(ckpt);
+  ckpt->used = false;
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "mem/colour_bench.h"
+#include "arch/x86/tsc.h"
+#include "lib/log.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Boot-time benchmark for page colouring. Memory is first aged so that the
+ * only low free frames all share one colour, which is what alloc_frame hands a
+ * long-running system. A strided walk touching the same line of every page is
+ * then timed with frames from each allocation mode; same-colour frames compete
+ * for 1/PAGE_COLOURS of the L2 sets and miss on every pass. kmain only runs it
+ * in kernels built with make COLOUR_BENCH=1.
+ */
+
+static uint32_t fragment_frames[COLOUR_BENCH_PAGES * PAGE_COLOURS];
+static uint32_t bench_frames[COLOUR_BENCH_PAGES];
+
+static uint32_t fragment_memory(void) {
+  uint32_t count = 0;
+
+  for (; count < COLOUR_BENCH_PAGES * PAGE_COLOURS; count++) {
+    fragment_frames[count] = alloc_frame();
+    if (fragment_frames[count] == 0) {
+      break;
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    if ((fragment_frames[i] / FRAME_SIZE) % PAGE_COLOURS == 0) {
+      free_frame(fragment_frames[i]);
+      fragment_frames[i] = 0;
+    }
+  }
+  return count;
+}
+
+static uint32_t time_strided_walk(bool coloured) {
+  bool previous = set_page_colouring(coloured);
+  uint32_t pages = 0;
+
+  for (; pages < COLOUR_BENCH_PAGES; pages++) {
+    bench_frames[pages] = alloc_frame_coloured(pages * FRAME_SIZE);
+    if (bench_frames[pages] == 0) {
+      break;
+    }
+  }
+  set_page_colouring(previous);
+
+  uint32_t sum = 0;
+  uint64_t start = rdtsc();
+  for (uint32_t pass = 0; pass < COLOUR_BENCH_PASSES; pass++) {
+    for (uint32_t offset = 0; offset < FRAME_SIZE; offset += COLOUR_BENCH_LINE) {
+      for (uint32_t i = 0; i < pages; i++) {
+        sum += *(volatile uint32_t*)(phys_to_virt(bench_frames[i]) + offset);
+      }
+    }
+  }
+  uint32_t cycles = (uint32_t)(rdtsc() - start);
+  (void)sum;
+
+  for (uint32_t i = 0; i < pages; i++) {
+    free_frame(bench_frames[i]);
+  }
+  return cycles;
+}
+
+void colour_bench_run(void) {
+  uint32_t fragmented = fragment_memory();
+
+  /* Run each mode twice and keep the second result so both start from a warm TLB. */
+  time_strided_walk(false);
+  uint32_t plain = time_strided_walk(false);
+  time_strided_walk(true);
+  uint32_t coloured = time_strided_walk(true);
+
+  for (uint32_t i = 0; i < fragmented; i++) {
+    if (fragment_frames[i] != 0) {
+      free_frame(fragment_frames[i]);
+    }
+  }
+
+  LOG_INFO("Page colouring: %d pages x %d passes, %d cycles uncoloured, %d cycles coloured", COLOUR_BENCH_PAGES,
+           COLOUR_BENCH_PASSES, plain, coloured);
+}
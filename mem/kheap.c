@@ -0,0 +1,174 @@
+#include "mem/kheap.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include <stdint.h>
+
+/*
+ * Small objects come from single-frame slabs, one size class per slab, with a
+ * header at the start of the frame. Larger requests get contiguous frames
+ * behind the same header so kfree can tell them apart.
+ */
+
+#define KHEAP_SLAB_MAGIC 0x51AB51AB
+#define KHEAP_LARGE_MAGIC 0x1A9E1A9E
+#define KHEAP_HEADER_SIZE 32
+
+typedef struct kheap_slab {
+  uint32_t magic;
+  uint32_t size;
+  uint32_t free_count;
+  void* free_list;
+  struct kheap_slab* prev;
+  struct kheap_slab* next;
+} kheap_slab_t;
+
+/* Sized so each slab holds a whole number of objects with little slack after the header. */
+static const uint32_t size_classes[] = {16, 32, 64, 128, 256, 384, 496, 672, 1008, 1344, 2032};
+
+#define NUM_SIZE_CLASSES (sizeof(size_classes) / sizeof(size_classes[0]))
+
+/* Slabs with at least one free object, per size class. */
+static kheap_slab_t* partial_slabs[NUM_SIZE_CLASSES];
+
+static uint32_t objects_per_slab(uint32_t size) { return (FRAME_SIZE - KHEAP_HEADER_SIZE) / size; }
+
+static int size_class_index(size_t size) {
+  for (uint32_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+    if (size <= size_classes[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void link_slab(int class_idx, kheap_slab_t* slab) {
+  slab->prev = NULL;
+  slab->next = partial_slabs[class_idx];
+  if (slab->next) {
+    slab->next->prev = slab;
+  }
+  partial_slabs[class_idx] = slab;
+}
+
+static void unlink_slab(int class_idx, kheap_slab_t* slab) {
+  if (slab->prev) {
+    slab->prev->next = slab->next;
+  } else {
+    partial_slabs[class_idx] = slab->next;
+  }
+  if (slab->next) {
+    slab->next->prev = slab->prev;
+  }
+  slab->prev = NULL;
+  slab->next = NULL;
+}
+
+static kheap_slab_t* new_slab(uint32_t size) {
+  uint32_t frame = alloc_frame();
+  if (frame == 0) {
+    return NULL;
+  }
+
+  kheap_slab_t* slab = (kheap_slab_t*)phys_to_virt(frame);
+  slab->magic = KHEAP_SLAB_MAGIC;
+  slab->size = size;
+  slab->free_count = objects_per_slab(size);
+  slab->free_list = NULL;
+  slab->prev = NULL;
+  slab->next = NULL;
+
+  uint8_t* objects = (uint8_t*)slab + KHEAP_HEADER_SIZE;
+  for (uint32_t i = slab->free_count; i > 0; i--) {
+    void** object = (void**)(objects + (i - 1) * size);
+    *object = slab->free_list;
+    slab->free_list = object;
+  }
+
+  return slab;
+}
+
+static void* alloc_large(size_t size) {
+  uint32_t count = (size + KHEAP_HEADER_SIZE + FRAME_SIZE - 1) / FRAME_SIZE;
+  uint32_t frames = alloc_frames(count);
+  if (frames == 0) {
+    LOG_ERROR("kmalloc: failed to allocate %d contiguous frames", count);
+    return NULL;
+  }
+
+  kheap_slab_t* header = (kheap_slab_t*)phys_to_virt(frames);
+  header->magic = KHEAP_LARGE_MAGIC;
+  header->size = count;
+  return (uint8_t*)header + KHEAP_HEADER_SIZE;
+}
+
+void* kmalloc(size_t size) {
+  if (size == 0) {
+    return NULL;
+  }
+
+  int class_idx = size_class_index(size);
+  if (class_idx < 0) {
+    return alloc_large(size);
+  }
+
+  kheap_slab_t* slab = partial_slabs[class_idx];
+  if (slab == NULL) {
+    slab = new_slab(size_classes[class_idx]);
+    if (slab == NULL) {
+      return NULL;
+    }
+    link_slab(class_idx, slab);
+  }
+
+  void** object = slab->free_list;
+  slab->free_list = *object;
+  if (--slab->free_count == 0) {
+    unlink_slab(class_idx, slab);
+  }
+
+  return object;
+}
+
+void* kzalloc(size_t size) {
+  void* ptr = kmalloc(size);
+  if (ptr) {
+    memset(ptr, 0, size);
+  }
+  return ptr;
+}
+
+void kfree(void* ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+
+  kheap_slab_t* slab = (kheap_slab_t*)((uint32_t)ptr & ~(FRAME_SIZE - 1));
+
+  if (slab->magic == KHEAP_LARGE_MAGIC && (uint8_t*)ptr == (uint8_t*)slab + KHEAP_HEADER_SIZE) {
+    slab->magic = 0;
+    free_frames(virt_to_phys((uint32_t)slab), slab->size);
+    return;
+  }
+
+  if (slab->magic != KHEAP_SLAB_MAGIC) {
+    LOG_ERROR("kfree: 0x%x is not a heap pointer", ptr);
+    return;
+  }
+
+  int class_idx = size_class_index(slab->size);
+  if (slab->free_count == 0) {
+    link_slab(class_idx, slab);
+  }
+
+  void** object = ptr;
+  *object = slab->free_list;
+  slab->free_list = object;
+
+  if (++slab->free_count == objects_per_slab(slab->size)) {
+    unlink_slab(class_idx, slab);
+    slab->magic = 0;
+    free_frame(virt_to_phys((uint32_t)slab));
+  }
+}
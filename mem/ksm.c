@@ -0,0 +1,278 @@
+#include "mem/ksm.h"
+#include "arch/x86/interrupt.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "sched/sched.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Frames every mapping of which is read-only + COW. KSM holds one reference on each. */
+typedef struct {
+  bool used;
+  uint32_t frame;
+  uint32_t hash;
+} ksm_stable_page_t;
+
+/* Candidates seen during the current full scan, waiting for an identical partner. */
+typedef struct {
+  uint32_t pid;
+  uint32_t vaddr;
+  uint32_t frame;
+  uint32_t hash;
+} ksm_unstable_page_t;
+
+static ksm_stable_page_t stable_pages[KSM_MAX_STABLE_PAGES];
+static ksm_unstable_page_t unstable_pages[KSM_MAX_UNSTABLE_PAGES];
+static uint32_t num_unstable = 0;
+
+static uint32_t cursor_pid = 0;
+static uint32_t cursor_addr = 0;
+static ksmstat_t ksm_stats;
+
+static uint32_t hash_frame(uint32_t frame) {
+  const uint32_t* words = (const uint32_t*)phys_to_virt(frame);
+  uint32_t hash = 2166136261u;
+
+  for (uint32_t i = 0; i < FRAME_SIZE / sizeof(uint32_t); i++) {
+    hash = (hash ^ words[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static bool frames_equal(uint32_t a, uint32_t b) {
+  const uint32_t* wa = (const uint32_t*)phys_to_virt(a);
+  const uint32_t* wb = (const uint32_t*)phys_to_virt(b);
+
+  for (uint32_t i = 0; i < FRAME_SIZE / sizeof(uint32_t); i++) {
+    if (wa[i] != wb[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Only writable pages: break_cow makes the page writable again, which a read-only mapping must never become. */
+static bool is_candidate(uint32_t pte) {
+  if ((pte & (PAGE_PRESENT | PAGE_USER | PAGE_RW)) != (PAGE_PRESENT | PAGE_USER | PAGE_RW)) {
+    return false;
+  }
+  if (pte & (PAGE_SHARED | PAGE_COW)) {
+    return false;
+  }
+  return frame_refcount(pte & ~0xFFF) == 1;
+}
+
+static void write_protect(uint32_t* page_dir, uint32_t vaddr, uint32_t frame, uint32_t pte) {
+  map_page(page_dir, vaddr, frame, ((pte & 0xFFF) & ~PAGE_RW) | PAGE_COW);
+}
+
+static ksm_stable_page_t* find_stable(uint32_t frame, uint32_t hash) {
+  for (int i = 0; i < KSM_MAX_STABLE_PAGES; i++) {
+    ksm_stable_page_t* page = &stable_pages[i];
+    if (page->used && page->hash == hash && page->frame != frame && frames_equal(page->frame, frame)) {
+      return page;
+    }
+  }
+  return NULL;
+}
+
+static ksm_stable_page_t* add_stable(uint32_t frame, uint32_t hash) {
+  for (int i = 0; i < KSM_MAX_STABLE_PAGES; i++) {
+    ksm_stable_page_t* page = &stable_pages[i];
+    if (!page->used) {
+      page->used = true;
+      page->frame = frame;
+      page->hash = hash;
+      ref_frame(frame);
+      return page;
+    }
+  }
+  return NULL;
+}
+
+static void merge_into(uint32_t* page_dir, uint32_t vaddr, uint32_t pte, ksm_stable_page_t* stable) {
+  uint32_t old_frame = pte & ~0xFFF;
+
+  ref_frame(stable->frame);
+  write_protect(page_dir, vaddr, stable->frame, pte);
+  unref_frame(old_frame);
+
+  LOG_DEBUG("KSM: merged page 0x%x (frame 0x%x -> 0x%x)", vaddr, old_frame, stable->frame);
+}
+
+/* Promotes an unstable candidate to a stable page if its owner still maps the same, unchanged frame. */
+static ksm_stable_page_t* promote(ksm_unstable_page_t* candidate, uint32_t frame) {
+  process_t* owner = get_process_by_pid(candidate->pid);
+  if (owner == NULL || owner->mm_live == 0) {
+    return NULL;
+  }
+
+  uint32_t* owner_dir = (uint32_t*)owner->context.cr3;
+  uint32_t* pte = get_page_entry(owner_dir, candidate->vaddr);
+  if (pte == NULL || !is_candidate(*pte) || (*pte & ~0xFFF) != candidate->frame) {
+    return NULL;
+  }
+
+  if (!frames_equal(candidate->frame, frame)) {
+    return NULL;
+  }
+
+  ksm_stable_page_t* stable = add_stable(candidate->frame, candidate->hash);
+  if (stable == NULL) {
+    return NULL;
+  }
+
+  write_protect(owner_dir, candidate->vaddr, candidate->frame, *pte);
+  return stable;
+}
+
+static void scan_page(process_t* proc, uint32_t vaddr, uint32_t pte) {
+  uint32_t* page_dir = (uint32_t*)proc->context.cr3;
+  uint32_t frame = pte & ~0xFFF;
+  uint32_t hash = hash_frame(frame);
+
+  ksm_stable_page_t* stable = find_stable(frame, hash);
+  if (stable) {
+    merge_into(page_dir, vaddr, pte, stable);
+    return;
+  }
+
+  for (uint32_t i = 0; i < num_unstable; i++) {
+    ksm_unstable_page_t* candidate = &unstable_pages[i];
+    if (candidate->hash != hash || candidate->frame == frame) {
+      continue;
+    }
+
+    stable = promote(candidate, frame);
+    if (stable) {
+      *candidate = unstable_pages[--num_unstable];
+      merge_into(page_dir, vaddr, pte, stable);
+      return;
+    }
+  }
+
+  if (num_unstable < KSM_MAX_UNSTABLE_PAGES) {
+    unstable_pages[num_unstable].pid = proc->pid;
+    unstable_pages[num_unstable].vaddr = vaddr;
+    unstable_pages[num_unstable].frame = frame;
+    unstable_pages[num_unstable].hash = hash;
+    num_unstable++;
+  }
+}
+
+/* Scans proc from cursor_addr until the budget runs out. Returns true once the whole process is done. */
+static bool scan_process(process_t* proc, uint32_t* budget) {
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+
+  while (cursor_addr < KERNEL_VIRTUAL_START) {
+    uint32_t pde_idx = cursor_addr >> 22;
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      cursor_addr = (pde_idx + 1) << 22;
+      if (cursor_addr == 0) {
+        break;
+      }
+      continue;
+    }
+
+    if (*budget == 0) {
+      return false;
+    }
+
+    uint32_t* pte = get_page_entry((uint32_t*)proc->context.cr3, cursor_addr);
+    if (pte && is_candidate(*pte)) {
+      scan_page(proc, cursor_addr, *pte);
+      (*budget)--;
+    }
+    cursor_addr += FRAME_SIZE;
+  }
+
+  return true;
+}
+
+static void update_stats(void) {
+  ksm_stats.pages_shared = 0;
+  ksm_stats.pages_sharing = 0;
+
+  for (int i = 0; i < KSM_MAX_STABLE_PAGES; i++) {
+    ksm_stable_page_t* page = &stable_pages[i];
+    if (!page->used) {
+      continue;
+    }
+
+    uint32_t mappings = frame_refcount(page->frame) - 1;
+    if (mappings == 0) {
+      page->used = false;
+      unref_frame(page->frame);
+      continue;
+    }
+
+    ksm_stats.pages_shared++;
+    ksm_stats.pages_sharing += mappings;
+  }
+
+  ksm_stats.pages_saved = ksm_stats.pages_sharing - ksm_stats.pages_shared;
+}
+
+static void ksm_pass(void) {
+  uint32_t budget = KSM_PAGES_PER_PASS;
+
+  while (budget > 0) {
+    process_t* proc = get_next_process(cursor_pid);
+    while (proc && (proc->leader != proc || proc->mm_live == 0 || proc->context.stack.cs != USER_CS_SELECTOR)) {
+      proc = get_next_process(proc->pid + 1);
+    }
+
+    if (proc == NULL) {
+      cursor_pid = 0;
+      cursor_addr = 0;
+      num_unstable = 0;
+      ksm_stats.full_scans++;
+      update_stats();
+      LOG_DEBUG("KSM: full scan %d done, %d pages saved", ksm_stats.full_scans, ksm_stats.pages_saved);
+      return;
+    }
+
+    if (proc->pid != cursor_pid) {
+      cursor_pid = proc->pid;
+      cursor_addr = 0;
+    }
+
+    if (!scan_process(proc, &budget)) {
+      return;
+    }
+
+    cursor_pid = proc->pid + 1;
+    cursor_addr = 0;
+  }
+}
+
+/*
+ * Merging rewrites PTEs, the rmap and frame refcounts, so it runs in its own
+ * kernel task rather than the timer interrupt, which could land in the middle
+ * of a syscall updating the same structures. Kernel tasks are not preempted,
+ * so a pass is never interleaved with one either.
+ */
+static void ksm_task(void) {
+  while (1) {
+    ksm_pass();
+
+    uint32_t eflags = interrupt_save();
+    current_process->state = PROCESS_STATE_BLOCKED;
+    schedule_timeout(KSM_SCAN_INTERVAL, 0);
+    interrupt_restore(eflags);
+  }
+}
+
+void ksm_init(void) {
+  if (create_kernel_process(ksm_task) == NULL) {
+    LOG_ERROR("KSM: failed to start the scanner task");
+  }
+}
+
+void ksm_get_stats(ksmstat_t* stats) {
+  update_stats();
+  *stats = ksm_stats;
+}
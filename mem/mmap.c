@@ -0,0 +1,527 @@
+#include "mem/mmap.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "mem/rmap.h"
+#include "mem/shm.h"
+#include "mem/swap.h"
+#include <stddef.h>
+
+#define PAGE_ALIGN_UP(addr) (((addr) + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1))
+
+static bool is_anonymous(vm_area_t* area) { return (area->flags & MAP_ANONYMOUS) != 0; }
+
+vm_area_t* vm_find_area(process_t* proc, uint32_t addr) {
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    vm_area_t* area = &process_vm_areas(proc)[i];
+    if (area->used && addr >= area->start && addr < area->end) {
+      return area;
+    }
+  }
+  return NULL;
+}
+
+static vm_area_t* alloc_area(process_t* proc) {
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    if (!process_vm_areas(proc)[i].used) {
+      return &process_vm_areas(proc)[i];
+    }
+  }
+  return NULL;
+}
+
+/* Splits area at addr and returns the upper half, or NULL if no area slot is free. */
+static vm_area_t* split_area(process_t* proc, vm_area_t* area, uint32_t addr) {
+  vm_area_t* tail = alloc_area(proc);
+  if (tail == NULL) {
+    LOG_ERROR("PID %d has no free memory area to split 0x%x - 0x%x", proc->pid, area->start, area->end);
+    return NULL;
+  }
+
+  *tail = *area;
+  if (tail->shm) {
+    shm_get(tail->shm);
+  }
+  tail->start = addr;
+  tail->offset += addr - area->start;
+  area->end = addr;
+  return tail;
+}
+
+static uint32_t find_free_range(process_t* proc, uint32_t length) {
+  uint32_t addr = USER_MMAP_START;
+  bool moved = true;
+
+  while (moved) {
+    moved = false;
+    for (int i = 0; i < MAX_VM_AREAS; i++) {
+      vm_area_t* area = &process_vm_areas(proc)[i];
+      if (area->used && addr < area->end && addr + length > area->start) {
+        addr = area->end;
+        moved = true;
+      }
+    }
+    if (addr + length > USER_MMAP_END || addr + length < addr) {
+      return 0;
+    }
+  }
+
+  return addr;
+}
+
+static void unmap_range(process_t* proc, uint32_t start, uint32_t end) {
+  uint32_t* page_dir = (uint32_t*)proc->context.cr3;
+
+  for (uint32_t addr = start; addr < end; addr += FRAME_SIZE) {
+    uint32_t* pte = get_page_entry(page_dir, addr);
+    if (pte && (*pte & PAGE_PRESENT)) {
+      uint32_t frame = *pte & ~0xFFF;
+      unmap_page(page_dir, addr);
+      unref_frame(frame);
+    } else if (pte && is_swap_entry(*pte)) {
+      swap_free_entry(*pte);
+      unmap_page(page_dir, addr);
+    }
+  }
+}
+
+static bool is_page_present(process_t* proc, uint32_t addr) {
+  uint32_t* pte = get_page_entry((uint32_t*)proc->context.cr3, addr);
+  return pte && (*pte & (PAGE_PRESENT | PAGE_SWAPPED));
+}
+
+static void read_file_page(vm_area_t* area, uint32_t file_offset, void* dest) {
+  fs_descriptor_t desc = area->file;
+
+  memset(dest, 0, FRAME_SIZE);
+  if (file_offset < desc.size && seek_file(&desc, file_offset) == 0) {
+    read_file(&desc, dest, FRAME_SIZE);
+  }
+}
+
+static vm_fault_t fault_in_page(process_t* proc, vm_area_t* area, uint32_t page_addr, bool write) {
+  uint32_t* page_dir = (uint32_t*)proc->context.cr3;
+  bool writable = (area->prot & PROT_WRITE) != 0;
+  bool shared = (area->flags & MAP_SHARED) != 0;
+
+  /* A page faulted in is new to this address, so it starts soft-dirty whatever it held before. */
+  uint32_t flags = PAGE_PRESENT | PAGE_USER | PAGE_DIRTY;
+  if (shared) {
+    flags |= PAGE_SHARED;
+  }
+
+  uint32_t file_offset = area->offset + (page_addr - area->start);
+
+  if (area->shm) {
+    uint32_t frame = shm_page_frame(area->shm, file_offset / FRAME_SIZE);
+    if (frame == 0) {
+      return VM_FAULT_SIGSEGV;
+    }
+    ref_frame(frame);
+    map_page(page_dir, page_addr, frame, writable ? flags | PAGE_RW : flags);
+    return VM_FAULT_HANDLED;
+  }
+
+  uint32_t file_phys = 0;
+  bool zero_copy = !is_anonymous(area) && get_file_page(&area->file, file_offset, &file_phys) == 0;
+
+  if (zero_copy && (shared || !write)) {
+    if (writable) {
+      flags |= PAGE_COW;
+    }
+    map_page(page_dir, page_addr, file_phys, flags);
+    return VM_FAULT_HANDLED;
+  }
+
+  uint32_t frame = alloc_user_frame(page_addr);
+  if (frame == 0) {
+    return VM_FAULT_OOM;
+  }
+
+  void* frame_virt = (void*)phys_to_virt(frame);
+  if (zero_copy) {
+    memcpy(frame_virt, (void*)phys_to_virt(file_phys), FRAME_SIZE);
+  } else if (!is_anonymous(area)) {
+    read_file_page(area, file_offset, frame_virt);
+  } else {
+    memset(frame_virt, 0, FRAME_SIZE);
+  }
+
+  if (writable) {
+    flags |= PAGE_RW;
+  }
+  map_page(page_dir, page_addr, frame, flags);
+  if (!shared) {
+    swap_lru_add(frame);
+  }
+
+  return VM_FAULT_HANDLED;
+}
+
+static vm_fault_t populate_range(process_t* proc, vm_area_t* area, uint32_t start, uint32_t end) {
+  if (area->uffd) {
+    return VM_FAULT_HANDLED;
+  }
+
+  for (uint32_t addr = start; addr < end; addr += FRAME_SIZE) {
+    if (is_page_present(proc, addr)) {
+      continue;
+    }
+
+    vm_fault_t result = fault_in_page(proc, area, addr, false);
+    if (result != VM_FAULT_HANDLED) {
+      return result;
+    }
+  }
+  return VM_FAULT_HANDLED;
+}
+
+/* Anonymous memory is only prefaulted under MADV_SEQUENTIAL; file pages are cheap to map around. */
+static uint32_t fault_around_pages(vm_area_t* area) {
+  switch (area->advice) {
+  case MADV_RANDOM:
+    return 1;
+  case MADV_SEQUENTIAL:
+    return READAHEAD_PAGES;
+  default:
+    return is_anonymous(area) ? 1 : FAULT_AROUND_PAGES;
+  }
+}
+
+uint32_t vm_mmap(process_t* proc, fs_descriptor_t* file, uint32_t offset, uint32_t length, uint32_t prot,
+                 uint32_t flags) {
+  uint32_t sharing = flags & (MAP_SHARED | MAP_PRIVATE);
+  if (length == 0 || (sharing != MAP_SHARED && sharing != MAP_PRIVATE)) {
+    LOG_ERROR("mmap: invalid length or sharing flags (length: %d, flags: 0x%x)", length, flags);
+    return 0;
+  }
+
+  if (!(flags & MAP_ANONYMOUS)) {
+    if (file == NULL || file->type != FS_TYPE_FILE || (offset & (FRAME_SIZE - 1)) || offset >= file->size) {
+      LOG_ERROR("mmap: invalid file or offset 0x%x", offset);
+      return 0;
+    }
+
+    if (sharing == MAP_SHARED && (prot & PROT_WRITE)) {
+      LOG_ERROR("mmap: shared writable file mappings are not supported");
+      return 0;
+    }
+  }
+
+  length = PAGE_ALIGN_UP(length);
+
+  vm_area_t* area = alloc_area(proc);
+  if (area == NULL) {
+    LOG_ERROR("mmap: PID %d has no free memory areas", proc->pid);
+    return 0;
+  }
+
+  uint32_t start = find_free_range(proc, length);
+  if (start == 0) {
+    LOG_ERROR("mmap: no free address range for %d bytes", length);
+    return 0;
+  }
+
+  memset(area, 0, sizeof(vm_area_t));
+  area->used = true;
+  area->start = start;
+  area->end = start + length;
+  area->prot = prot;
+  area->flags = flags;
+  area->advice = MADV_NORMAL;
+  if (!(flags & MAP_ANONYMOUS)) {
+    area->offset = offset;
+    area->file = *file;
+  }
+
+  LOG_DEBUG("mmap: PID %d mapped 0x%x - 0x%x (prot: 0x%x, flags: 0x%x, offset: 0x%x)", proc->pid, area->start,
+            area->end, prot, flags, offset);
+
+  if ((flags & MAP_POPULATE) && prot != PROT_NONE &&
+      populate_range(proc, area, area->start, area->end) != VM_FAULT_HANDLED) {
+    LOG_WARN("mmap: MAP_POPULATE stopped early, remaining pages will fault on demand");
+  }
+
+  return start;
+}
+
+uint32_t vm_map_shm(process_t* proc, shm_segment_t* seg, uint32_t prot) {
+  uint32_t length = seg->num_pages * FRAME_SIZE;
+
+  vm_area_t* area = alloc_area(proc);
+  if (area == NULL) {
+    LOG_ERROR("shm: PID %d has no free memory areas", proc->pid);
+    return 0;
+  }
+
+  uint32_t start = find_free_range(proc, length);
+  if (start == 0) {
+    LOG_ERROR("shm: no free address range for %d bytes", length);
+    return 0;
+  }
+
+  memset(area, 0, sizeof(vm_area_t));
+  area->used = true;
+  area->start = start;
+  area->end = start + length;
+  area->prot = prot;
+  area->flags = MAP_SHARED;
+  area->advice = MADV_NORMAL;
+  area->shm = seg;
+  shm_get(seg);
+
+  LOG_DEBUG("shm: PID %d mapped %s at 0x%x - 0x%x (prot: 0x%x)", proc->pid, seg->name, area->start, area->end,
+            prot);
+  return start;
+}
+
+void vm_copy_areas(process_t* dst, process_t* src) {
+  memcpy(dst->vm_areas, process_vm_areas(src), sizeof(dst->vm_areas));
+
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    dst->vm_areas[i].uffd = NULL;
+    if (dst->vm_areas[i].used && dst->vm_areas[i].shm) {
+      shm_get(dst->vm_areas[i].shm);
+    }
+  }
+}
+
+static int split_areas_at(process_t* proc, uint32_t addr) {
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    vm_area_t* area = &process_vm_areas(proc)[i];
+    if (area->used && addr > area->start && addr < area->end) {
+      return split_area(proc, area, addr) != NULL ? 0 : -1;
+    }
+  }
+  return 0;
+}
+
+/* Splits areas at both ends of [addr, end) so every area overlapping the range lies inside it. */
+int vm_split_range(process_t* proc, uint32_t addr, uint32_t end) {
+  return split_areas_at(proc, addr) != 0 || split_areas_at(proc, end) != 0 ? -1 : 0;
+}
+
+/* Splits areas at both ends of [addr, end) and runs fn on every area left inside the range. */
+static int for_each_area_in_range(process_t* proc, uint32_t addr, uint32_t end,
+                                  int (*fn)(process_t* proc, vm_area_t* area, uint32_t arg), uint32_t arg) {
+  if (vm_split_range(proc, addr, end) != 0) {
+    return -1;
+  }
+
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    vm_area_t* area = &process_vm_areas(proc)[i];
+    if (area->used && area->start >= addr && area->end <= end && fn(proc, area, arg) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int unmap_area(process_t* proc, vm_area_t* area, uint32_t arg) {
+  (void)arg;
+  unmap_range(proc, area->start, area->end);
+  if (area->shm) {
+    shm_put(area->shm);
+    area->shm = NULL;
+  }
+  area->used = false;
+  return 0;
+}
+
+int vm_munmap(process_t* proc, uint32_t addr, uint32_t length) {
+  if ((addr & (FRAME_SIZE - 1)) || length == 0) {
+    return -1;
+  }
+
+  return for_each_area_in_range(proc, addr, addr + PAGE_ALIGN_UP(length), unmap_area, 0);
+}
+
+static int advise_area(process_t* proc, vm_area_t* area, uint32_t advice) {
+  switch (advice) {
+  case MADV_NORMAL:
+  case MADV_RANDOM:
+  case MADV_SEQUENTIAL:
+    area->advice = advice;
+    return 0;
+  case MADV_WILLNEED:
+    if (area->prot == PROT_NONE) {
+      return 0;
+    }
+    return populate_range(proc, area, area->start, area->end) == VM_FAULT_HANDLED ? 0 : -1;
+  case MADV_DONTNEED:
+    unmap_range(proc, area->start, area->end);
+    return 0;
+  default:
+    return -1;
+  }
+}
+
+int vm_madvise(process_t* proc, uint32_t addr, uint32_t length, uint32_t advice) {
+  if ((addr & (FRAME_SIZE - 1)) || length == 0 || advice > MADV_DONTNEED) {
+    return -1;
+  }
+
+  uint32_t end = addr + PAGE_ALIGN_UP(length);
+
+  for (uint32_t page = addr; page < end; page += FRAME_SIZE) {
+    vm_area_t* area = vm_find_area(proc, page);
+    if (area == NULL) {
+      LOG_ERROR("madvise: PID %d range 0x%x - 0x%x is not fully mapped", proc->pid, addr, end);
+      return -1;
+    }
+
+    /* Shared anonymous pages live only in the page tables, so dropping them would lose the shared contents. */
+    if (advice == MADV_DONTNEED && (area->flags & MAP_SHARED) && is_anonymous(area)) {
+      LOG_ERROR("madvise: PID %d cannot drop shared anonymous pages at 0x%x", proc->pid, page);
+      return -1;
+    }
+  }
+
+  return for_each_area_in_range(proc, addr, end, advise_area, advice);
+}
+
+static vm_fault_t break_cow(process_t* proc, uint32_t page_addr, uint32_t pte) {
+  uint32_t* page_dir = (uint32_t*)proc->context.cr3;
+  uint32_t old_frame = pte & ~0xFFF;
+  uint32_t flags = ((pte & 0xFFF) & ~PAGE_COW) | PAGE_RW;
+
+  if (frame_refcount(old_frame) == 1) {
+    map_page(page_dir, page_addr, old_frame, flags);
+    swap_lru_add(old_frame);
+    return VM_FAULT_HANDLED;
+  }
+
+  uint32_t new_frame = alloc_user_frame(page_addr);
+  if (new_frame == 0) {
+    return VM_FAULT_OOM;
+  }
+
+  memcpy((void*)phys_to_virt(new_frame), (void*)phys_to_virt(old_frame), FRAME_SIZE);
+  map_page(page_dir, page_addr, new_frame, flags);
+  unref_frame(old_frame);
+  swap_lru_add(new_frame);
+
+  LOG_DEBUG("COW: PID %d copied page 0x%x (frame 0x%x -> 0x%x)", proc->pid, page_addr, old_frame, new_frame);
+  return VM_FAULT_HANDLED;
+}
+
+vm_fault_t vm_handle_fault(process_t* proc, uint32_t addr, bool present, bool write) {
+  uint32_t page_addr = addr & ~0xFFF;
+
+  uint32_t* pte = get_page_entry((uint32_t*)proc->context.cr3, page_addr);
+
+  if (present) {
+    if (write && pte && (*pte & PAGE_COW)) {
+      return break_cow(proc, page_addr, *pte);
+    }
+    return VM_FAULT_NO_AREA;
+  }
+
+  if (pte && is_swap_entry(*pte)) {
+    return swap_in(proc, page_addr);
+  }
+
+  vm_area_t* area = vm_find_area(proc, addr);
+  if (area == NULL) {
+    return VM_FAULT_NO_AREA;
+  }
+
+  if ((write && !(area->prot & PROT_WRITE)) || area->prot == PROT_NONE) {
+    return VM_FAULT_SIGSEGV;
+  }
+
+  if (area->uffd) {
+    return VM_FAULT_USERFAULT;
+  }
+
+  vm_fault_t result = fault_in_page(proc, area, page_addr, write);
+  if (result != VM_FAULT_HANDLED) {
+    return result;
+  }
+
+  uint32_t around_end = page_addr + fault_around_pages(area) * FRAME_SIZE;
+  if (around_end > area->end || around_end < page_addr) {
+    around_end = area->end;
+  }
+  populate_range(proc, area, page_addr + FRAME_SIZE, around_end);
+
+  return VM_FAULT_HANDLED;
+}
+
+/*
+ * Maps every user page of src into dst. Private writable pages become
+ * read-only COW in both address spaces; shared and read-only pages are
+ * mapped as they are. Each new mapping takes a frame reference.
+ */
+int vm_share_address_space(process_t* dst, process_t* src) {
+  uint32_t* src_dir = (uint32_t*)phys_to_virt(src->context.cr3);
+
+  for (uint32_t pde_idx = 0; pde_idx < KERNEL_PDT_IDX; pde_idx++) {
+    if (!(src_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(src_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE; pte_idx++) {
+      uint32_t vaddr = (pde_idx << 22) | (pte_idx << 12);
+
+      if (is_swap_entry(page_table[pte_idx]) && swap_in(src, vaddr) != VM_FAULT_HANDLED) {
+        return -1;
+      }
+
+      uint32_t pte = page_table[pte_idx];
+      if (!(pte & PAGE_PRESENT)) {
+        continue;
+      }
+
+      uint32_t frame = pte & ~0xFFF;
+      uint32_t flags = pte & 0xFFF & ~(PAGE_ACCESSED | PAGE_DIRTY);
+      if (!(flags & PAGE_SHARED) && (flags & PAGE_RW)) {
+        flags = (flags & ~PAGE_RW) | PAGE_COW;
+        map_page((uint32_t*)src->context.cr3, vaddr, frame, flags);
+      }
+
+      ref_frame(frame);
+      map_page((uint32_t*)dst->context.cr3, vaddr, frame, flags);
+    }
+  }
+
+  vm_copy_areas(dst, src);
+  return 0;
+}
+
+/* Drops every user mapping, memory area and page table of proc, then its page directory. */
+void vm_release_address_space(process_t* proc) {
+  for (int i = 0; i < MAX_VM_AREAS; i++) {
+    if (process_vm_areas(proc)[i].used) {
+      unmap_area(proc, &process_vm_areas(proc)[i], 0);
+    }
+  }
+
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+  for (uint32_t pde_idx = 0; pde_idx < KERNEL_PDT_IDX; pde_idx++) {
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(page_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE; pte_idx++) {
+      uint32_t pte = page_table[pte_idx];
+      if (pte & PAGE_PRESENT) {
+        rmap_remove(pte & ~0xFFF, (uint32_t*)proc->context.cr3, (pde_idx << 22) | (pte_idx << 12));
+        unref_frame(pte & ~0xFFF);
+      } else if (is_swap_entry(pte)) {
+        swap_free_entry(pte);
+      }
+    }
+
+    free_frame(page_dir[pde_idx] & ~0xFFF);
+    page_dir[pde_idx] = 0;
+  }
+
+  free_frame(proc->context.cr3);
+  proc->context.cr3 = 0;
+}
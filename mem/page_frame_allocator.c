@@ -1,39 +1,55 @@
 #include "mem/page_frame_allocator.h"
 #include "arch/x86/idt.h"
 #include "arch/x86/interrupt.h"
+#include "arch/x86/uaccess.h"
 #include "lib/log.h"
 #include "lib/string.h"
+#include "mem/mmap.h"
 #include "mem/paging.h"
 #include "mem/process.h"
+#include "mem/swap.h"
+#include "mem/userfaultfd.h"
 #include <stdbool.h>
 
 static uint32_t* frame_bitmap = NULL;
 static uint32_t bitmap_size = 0;
 static uint32_t total_frames = 0;
+static uint16_t* frame_refcounts = NULL;
+static uint32_t refcounts_size = 0;
+
+static bool colouring_enabled = false;
+static uint32_t colour_hint[PAGE_COLOURS];
 
 static uint32_t kernel_physical_start = 0;
 static uint32_t kernel_physical_end = 0;
 static uint32_t kernel_virtual_start = 0;
 static uint32_t kernel_virtual_end = 0;
 
-extern void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec);
+#define BITS_PER_WORD (sizeof(uint32_t) * BITS_PER_BYTE)
+
+extern void page_fault_handler(cpu_state_t* state, idt_info_t info, stack_state_t* exec);
 
 static void set_bit(uint32_t frame_idx) {
-  uint32_t byte_idx = frame_idx / BITS_PER_BYTE;
-  uint32_t bit_idx = frame_idx % BITS_PER_BYTE;
-  frame_bitmap[byte_idx] |= (1 << bit_idx);
+  uint32_t word_idx = frame_idx / BITS_PER_WORD;
+  uint32_t bit_idx = frame_idx % BITS_PER_WORD;
+  frame_bitmap[word_idx] |= (1 << bit_idx);
 }
 
 static void clear_bit(uint32_t frame_idx) {
-  uint32_t byte_idx = frame_idx / BITS_PER_BYTE;
-  uint32_t bit_idx = frame_idx % BITS_PER_BYTE;
-  frame_bitmap[byte_idx] &= ~(1 << bit_idx);
+  uint32_t word_idx = frame_idx / BITS_PER_WORD;
+  uint32_t bit_idx = frame_idx % BITS_PER_WORD;
+  frame_bitmap[word_idx] &= ~(1 << bit_idx);
+
+  uint32_t colour = frame_idx % PAGE_COLOURS;
+  if (frame_idx < colour_hint[colour]) {
+    colour_hint[colour] = frame_idx;
+  }
 }
 
 static bool test_bit(uint32_t frame_idx) {
-  uint32_t byte_idx = frame_idx / BITS_PER_BYTE;
-  uint32_t bit_idx = frame_idx % BITS_PER_BYTE;
-  return (frame_bitmap[byte_idx] & (1 << bit_idx)) != 0;
+  uint32_t word_idx = frame_idx / BITS_PER_WORD;
+  uint32_t bit_idx = frame_idx % BITS_PER_WORD;
+  return (frame_bitmap[word_idx] & (1 << bit_idx)) != 0;
 }
 
 uint32_t phys_to_virt(uint32_t phys_addr) { return phys_addr + (kernel_virtual_start - kernel_physical_start); }
@@ -82,8 +98,15 @@ void init_page_frame_allocator(uint32_t phys_start, uint32_t phys_end, uint32_t
 
   memset(frame_bitmap, 0, bitmap_size);
 
+  refcounts_size = (total_frames * sizeof(uint16_t) + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+  uint32_t refcounts_phys = bitmap_phys + bitmap_size;
+  frame_refcounts = (uint16_t*)phys_to_virt(refcounts_phys);
+  LOG_DEBUG("\tFrame refcounts: 0x%x (%d bytes)", frame_refcounts, refcounts_size);
+
+  memset(frame_refcounts, 0, refcounts_size);
+
   uint32_t kernel_start_frame = kernel_physical_start / FRAME_SIZE;
-  uint32_t bitmap_end_phys = bitmap_phys + bitmap_size;
+  uint32_t bitmap_end_phys = refcounts_phys + refcounts_size;
   uint32_t kernel_end_frame = bitmap_end_phys / FRAME_SIZE;
 
   LOG_DEBUG("\tKernel start frame: 0x%x", kernel_start_frame);
@@ -97,6 +120,12 @@ void init_page_frame_allocator(uint32_t phys_start, uint32_t phys_end, uint32_t
     set_bit(i);
   }
 
+  for (uint32_t i = 0; i < PAGE_COLOURS; i++) {
+    colour_hint[i] = i;
+  }
+
+  map_kernel_memory(total_physical_memory);
+
   register_interrupt_handler(INTERRUPT_PAGE_FAULT, page_fault_handler);
 
   LOG_INFO("Page frame allocator initialized");
@@ -107,19 +136,114 @@ uint32_t alloc_frame(void) {
   for (uint32_t i = 0; i < total_frames; i++) {
     if (!test_bit(i)) {
       set_bit(i);
+      frame_refcounts[i] = 1;
       return i * FRAME_SIZE;
     }
   }
   return 0;
 }
 
+/*
+ * Consecutive virtual pages get frames of consecutive colours, so a process's
+ * hot pages spread over the L2 sets instead of piling onto whichever colour
+ * happens to be lowest in the bitmap. Falls back to any frame when the bin is empty.
+ */
+uint32_t alloc_frame_coloured(uint32_t vaddr) {
+  if (!colouring_enabled) {
+    return alloc_frame();
+  }
+
+  uint32_t colour = (vaddr / FRAME_SIZE) % PAGE_COLOURS;
+  for (uint32_t i = colour_hint[colour]; i < total_frames; i += PAGE_COLOURS) {
+    if (!test_bit(i)) {
+      set_bit(i);
+      frame_refcounts[i] = 1;
+      colour_hint[colour] = i + PAGE_COLOURS;
+      return i * FRAME_SIZE;
+    }
+  }
+  colour_hint[colour] = total_frames;
+
+  return alloc_frame();
+}
+
+bool set_page_colouring(bool enable) {
+  bool previous = colouring_enabled;
+  colouring_enabled = enable;
+  return previous;
+}
+
+uint32_t alloc_frames(uint32_t count) {
+  uint32_t run = 0;
+
+  for (uint32_t i = 0; i < total_frames; i++) {
+    run = test_bit(i) ? 0 : run + 1;
+    if (run == count) {
+      uint32_t first = i + 1 - count;
+      for (uint32_t j = first; j <= i; j++) {
+        set_bit(j);
+        frame_refcounts[j] = 1;
+      }
+      return first * FRAME_SIZE;
+    }
+  }
+  return 0;
+}
+
 void free_frame(uint32_t frame_addr) {
   uint32_t frame_idx = frame_addr / FRAME_SIZE;
   if (frame_idx < total_frames) {
+    frame_refcounts[frame_idx] = 0;
     clear_bit(frame_idx);
   }
 }
 
+void free_frames(uint32_t frame_addr, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    free_frame(frame_addr + i * FRAME_SIZE);
+  }
+}
+
+void reserve_frames(uint32_t phys_start, uint32_t phys_end) {
+  uint32_t first = phys_start / FRAME_SIZE;
+  uint32_t last = (phys_end + FRAME_SIZE - 1) / FRAME_SIZE;
+
+  for (uint32_t i = first; i < last && i < total_frames; i++) {
+    set_bit(i);
+  }
+
+  LOG_DEBUG("Reserved frames 0x%x - 0x%x", first * FRAME_SIZE, last * FRAME_SIZE);
+}
+
+/* Reserved frames keep a zero refcount, so ref/unref never hand them back to the allocator. */
+void ref_frame(uint32_t frame_addr) {
+  uint32_t frame_idx = frame_addr / FRAME_SIZE;
+  if (frame_idx < total_frames && frame_refcounts[frame_idx] > 0) {
+    frame_refcounts[frame_idx]++;
+  }
+}
+
+void unref_frame(uint32_t frame_addr) {
+  uint32_t frame_idx = frame_addr / FRAME_SIZE;
+  if (frame_idx >= total_frames || frame_refcounts[frame_idx] == 0) {
+    return;
+  }
+
+  if (--frame_refcounts[frame_idx] == 0) {
+    clear_bit(frame_idx);
+  }
+}
+
+uint32_t frame_refcount(uint32_t frame_addr) {
+  uint32_t frame_idx = frame_addr / FRAME_SIZE;
+  if (frame_idx < total_frames) {
+    return frame_refcounts[frame_idx];
+  }
+  return 0;
+}
+
+uint32_t get_total_frames(void) { return total_frames; }
+
 bool is_frame_allocated(uint32_t frame_addr) {
   uint32_t frame_idx = frame_addr / FRAME_SIZE;
   if (frame_idx < total_frames) {
@@ -128,7 +252,19 @@ bool is_frame_allocated(uint32_t frame_addr) {
   return true;
 }
 
-void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec) {
+/* exec points into the interrupt frame, so redirecting eip resumes the kernel at the fixup. */
+static bool fixup_kernel_fault(stack_state_t* exec, uint32_t faulting_address) {
+  uint32_t fixup = search_exception_table(exec->eip);
+  if (fixup == 0) {
+    return false;
+  }
+
+  LOG_DEBUG("Bad user access at 0x%x from eip 0x%x, resuming at 0x%x", faulting_address, exec->eip, fixup);
+  exec->eip = fixup;
+  return true;
+}
+
+void page_fault_handler(cpu_state_t* state, idt_info_t info, stack_state_t* exec) {
   (void)state;
 
   uint32_t faulting_address;
@@ -143,8 +279,8 @@ void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec)
             faulting_address, error_code, present, write, user);
 
   LOG_DEBUG("  Fault details:");
-  LOG_DEBUG("    EIP: 0x%x", exec.eip);
-  LOG_DEBUG("    CS: 0x%x", exec.cs);
+  LOG_DEBUG("    EIP: 0x%x", exec->eip);
+  LOG_DEBUG("    CS: 0x%x", exec->cs);
   LOG_DEBUG("    Current process: PID %d", current_process ? current_process->pid : (uint32_t)-1);
   LOG_DEBUG("    Address region: %s",
             faulting_address >= USER_STACK_TOP - 0x100000 && faulting_address < USER_STACK_TOP ? "User stack" :
@@ -152,13 +288,47 @@ void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec)
             faulting_address >= KERNEL_VIRTUAL_START ? "Kernel space" : "Unknown");
 
   if (!current_process) {
+    if (fixup_kernel_fault(exec, faulting_address)) {
+      return;
+    }
     LOG_ERROR("Page fault with no current process at address: 0x%x", faulting_address);
     while (1) __asm__("hlt");
     return;
   }
 
   if (faulting_address >= KERNEL_VIRTUAL_START) {
-    LOG_ERROR("Page fault in kernel space at address: 0x%x, eip: 0x%x", faulting_address, exec.eip);
+    if (fixup_kernel_fault(exec, faulting_address)) {
+      return;
+    }
+    LOG_ERROR("Page fault in kernel space at address: 0x%x, eip: 0x%x", faulting_address, exec->eip);
+    while (1) __asm__("hlt");
+    return;
+  }
+
+  vm_fault_t vm_result = vm_handle_fault(current_process, faulting_address, present, write);
+  if (vm_result == VM_FAULT_HANDLED) {
+    return;
+  }
+
+  /* Kernel accesses cannot sleep for a userfault handler, so they fail with -EFAULT through the fixup. */
+  if (vm_result == VM_FAULT_USERFAULT && user) {
+    uffd_handle_fault(current_process, faulting_address, write);
+    return;
+  }
+
+  if (vm_result != VM_FAULT_NO_AREA && fixup_kernel_fault(exec, faulting_address)) {
+    return;
+  }
+
+  if (vm_result == VM_FAULT_OOM) {
+    LOG_ERROR("Out of memory resolving page fault at address: 0x%x", faulting_address);
+    while (1) __asm__("hlt");
+    return;
+  }
+
+  if (vm_result == VM_FAULT_SIGSEGV || vm_result == VM_FAULT_USERFAULT) {
+    LOG_ERROR("Page fault (access violation) at virtual address: 0x%x, eip: 0x%x, error_code: 0x%x",
+              faulting_address, exec->eip, error_code);
     while (1) __asm__("hlt");
     return;
   }
@@ -166,14 +336,17 @@ void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec)
   if (!present) {
     uint32_t page_addr = faulting_address & ~0xFFF;
 
-    uint32_t frame_phys = alloc_frame();
+    uint32_t frame_phys = alloc_user_frame(page_addr);
     if (frame_phys == 0) {
+      if (fixup_kernel_fault(exec, faulting_address)) {
+        return;
+      }
       LOG_ERROR("Failed to allocate frame for page fault at address: 0x%x", faulting_address);
       while (1) __asm__("hlt");
       return;
     }
 
-    uint32_t flags = PAGE_PRESENT | PAGE_USER;
+    uint32_t flags = PAGE_PRESENT | PAGE_USER | PAGE_DIRTY;
     if (write || page_addr < 0xC0000000) {
       flags |= PAGE_RW;
     }
@@ -183,6 +356,7 @@ void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec)
 
     uint32_t* page_virt = (uint32_t*)phys_to_virt(frame_phys);
     memset(page_virt, 0, FRAME_SIZE);
+    swap_lru_add(frame_phys);
 
     LOG_DEBUG("Successfully mapped virtual address 0x%x to physical frame 0x%x for PID %d",
               page_addr, frame_phys, current_process->pid);
@@ -193,8 +367,12 @@ void page_fault_handler(cpu_state_t state, idt_info_t info, stack_state_t exec)
     return;
   }
 
+  if (fixup_kernel_fault(exec, faulting_address)) {
+    return;
+  }
+
   LOG_ERROR("Page fault (protection violation) at virtual address: 0x%x, eip: 0x%x, error_code: 0x%x",
-            faulting_address, exec.eip, error_code);
+            faulting_address, exec->eip, error_code);
 
   while (1) __asm__("hlt");
 
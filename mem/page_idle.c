@@ -0,0 +1,77 @@
+#include "mem/page_idle.h"
+#include "lib/log.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "mem/swap.h"
+
+static uint32_t ticks_since_scan = 0;
+
+void page_idle_scan_process(process_t* proc) {
+  if (proc->context.cr3 == 0 || proc->context.stack.cs != USER_CS_SELECTOR) {
+    return;
+  }
+
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+  bool is_current = proc == current_process;
+  memstat_t stats = proc->mem_stats;
+
+  stats.resident_pages = 0;
+  stats.working_set_pages = 0;
+  stats.idle_pages = 0;
+  stats.dirty_pages = 0;
+  stats.swapped_pages = 0;
+
+  for (uint32_t pde_idx = 0; pde_idx < KERNEL_PDT_IDX; pde_idx++) {
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(page_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE; pte_idx++) {
+      uint32_t pte = page_table[pte_idx];
+      if (!(pte & PAGE_PRESENT)) {
+        if (pte & PAGE_SWAPPED) {
+          stats.swapped_pages++;
+        }
+        continue;
+      }
+
+      stats.resident_pages++;
+      if (pte & PAGE_DIRTY) {
+        stats.dirty_pages++;
+      }
+
+      if (!(pte & PAGE_ACCESSED)) {
+        stats.idle_pages++;
+        continue;
+      }
+
+      stats.working_set_pages++;
+      swap_lru_referenced(pte & ~0xFFF);
+      page_table[pte_idx] = pte & ~PAGE_ACCESSED;
+      if (is_current) {
+        uint32_t virt_addr = (pde_idx << 22) | (pte_idx << 12);
+        asm volatile("invlpg (%0)" ::"r"(virt_addr) : "memory");
+      }
+    }
+  }
+
+  stats.scans++;
+  proc->mem_stats = stats;
+}
+
+static void scan_if_live(process_t* proc) {
+  if (proc->leader == proc && proc->mm_live > 0) {
+    page_idle_scan_process(proc);
+  }
+}
+
+void page_idle_tick(void) {
+  if (++ticks_since_scan < PAGE_IDLE_SCAN_INTERVAL) {
+    return;
+  }
+
+  ticks_since_scan = 0;
+  for_each_process(scan_if_live);
+}
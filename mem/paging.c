@@ -2,9 +2,13 @@
 #include "lib/log.h"
 #include "lib/string.h"
 #include "mem/page_frame_allocator.h"
+#include "mem/rmap.h"
+#include <stdbool.h>
+#include <stddef.h>
 
 static uint32_t kernel_page_directory[PAGE_DIRECTORY_SIZE] __attribute__((aligned(4096)));
 static uint32_t kernel_page_table[PAGE_TABLE_SIZE] __attribute__((aligned(4096)));
+static uint32_t next_mmio_pd_index = KERNEL_MMIO_PDT_IDX;
 
 void init_paging(void) {
   memset(kernel_page_directory, 0, sizeof(kernel_page_directory));
@@ -26,9 +30,10 @@ void enable_paging(void) {
   cr4 |= 0x00000010;
   asm volatile("movl %0, %%cr4" ::"r"(cr4));
 
+  /* CR0.WP makes kernel writes honour read-only and COW PTEs, so copy_to_user faults into break_cow or -EFAULT. */
   uint32_t cr0;
   asm volatile("movl %%cr0, %0" : "=r"(cr0));
-  cr0 |= 0x80000000;
+  cr0 |= 0x80010000;
   asm volatile("movl %0, %%cr0" ::"r"(cr0));
 }
 
@@ -37,6 +42,64 @@ void setup_higher_half(void) {
   asm volatile("invlpg (%0)" ::"r"(0));
 }
 
+/* Maps physical memory beyond the boot page table with 4MB pages so phys_to_virt covers every frame. */
+void map_kernel_memory(uint32_t phys_end) {
+  for (uint32_t phys = PAGE_LARGE_SIZE; phys < phys_end; phys += PAGE_LARGE_SIZE) {
+    uint32_t pd_index = KERNEL_PDT_IDX + phys / PAGE_LARGE_SIZE;
+    if (pd_index >= KERNEL_VDSO_PDT_IDX) {
+      break;
+    }
+    kernel_page_directory[pd_index] = phys | PAGE_PRESENT | PAGE_RW | PAGE_SIZE_4MB;
+    asm volatile("invlpg (%0)" :: "r"(KERNEL_VIRTUAL_START + phys) : "memory");
+  }
+}
+
+/*
+ * Maps the uncached 4MB page holding a device's registers into the MMIO
+ * window and returns the virtual address of phys_addr. Only valid before the
+ * first process copies the kernel page directory.
+ */
+uint32_t map_kernel_mmio(uint32_t phys_addr) {
+  uint32_t large_page = phys_addr & ~(PAGE_LARGE_SIZE - 1);
+
+  for (uint32_t i = KERNEL_MMIO_PDT_IDX; i < next_mmio_pd_index; i++) {
+    if ((kernel_page_directory[i] & ~(PAGE_LARGE_SIZE - 1)) == large_page) {
+      return (i << 22) | (phys_addr & (PAGE_LARGE_SIZE - 1));
+    }
+  }
+
+  if (next_mmio_pd_index >= PAGE_DIRECTORY_SIZE) {
+    LOG_ERROR("No room left in the MMIO window for 0x%x", phys_addr);
+    return 0;
+  }
+
+  uint32_t pd_index = next_mmio_pd_index++;
+  kernel_page_directory[pd_index] =
+      large_page | PAGE_PRESENT | PAGE_RW | PAGE_NOCACHE | PAGE_WRITETHROUGH | PAGE_SIZE_4MB;
+  asm volatile("invlpg (%0)" ::"r"(pd_index << 22) : "memory");
+  return (pd_index << 22) | (phys_addr & (PAGE_LARGE_SIZE - 1));
+}
+
+/* Keeps the reverse map in step with a user PTE changing from old to new. */
+static void update_rmap(uint32_t* page_directory, uint32_t virtual_addr, uint32_t old, uint32_t new) {
+  if (virtual_addr >= KERNEL_VIRTUAL_START) {
+    return;
+  }
+
+  bool old_present = old & PAGE_PRESENT;
+  bool new_present = new & PAGE_PRESENT;
+  if (old_present && new_present && (old & ~0xFFF) == (new & ~0xFFF)) {
+    return;
+  }
+
+  if (old_present) {
+    rmap_remove(old & ~0xFFF, page_directory, virtual_addr);
+  }
+  if (new_present) {
+    rmap_add(new & ~0xFFF, page_directory, virtual_addr);
+  }
+}
+
 uint32_t* create_page_directory(void) {
   uint32_t page_dir_phys = alloc_frame();
   if (page_dir_phys == 0) {
@@ -77,6 +140,7 @@ void map_page(uint32_t* page_directory, uint32_t virtual_addr, uint32_t physical
   uint32_t pt_phys = pd_virt[pd_index] & ~0xFFF;
   uint32_t* pt_virt = (uint32_t*)phys_to_virt(pt_phys);
 
+  update_rmap(page_directory, virtual_addr, pt_virt[pt_index], physical_addr | flags);
   pt_virt[pt_index] = physical_addr | flags;
 
   asm volatile("invlpg (%0)" :: "r"(virtual_addr) : "memory");
@@ -95,6 +159,7 @@ void unmap_page(uint32_t* page_directory, uint32_t virtual_addr) {
   uint32_t pt_phys = pd_virt[pd_index] & ~0xFFF;
   uint32_t* pt_virt = (uint32_t*)phys_to_virt(pt_phys);
 
+  update_rmap(page_directory, virtual_addr, pt_virt[pt_index], 0);
   pt_virt[pt_index] = 0;
 
   asm volatile("invlpg (%0)" :: "r"(virtual_addr) : "memory");
@@ -121,3 +186,50 @@ uint32_t get_physical_address(uint32_t* page_directory, uint32_t virtual_addr) {
   uint32_t page_phys = pt_virt[pt_index] & ~0xFFF;
   return page_phys | offset;
 }
+
+uint32_t* get_page_entry(uint32_t* page_directory, uint32_t virtual_addr) {
+  uint32_t pd_index = virtual_addr >> 22;
+  uint32_t pt_index = (virtual_addr >> 12) & 0x3FF;
+
+  uint32_t* pd_virt = (uint32_t*)phys_to_virt((uint32_t)page_directory);
+
+  if (!(pd_virt[pd_index] & PAGE_PRESENT)) {
+    return NULL;
+  }
+
+  uint32_t* pt_virt = (uint32_t*)phys_to_virt(pd_virt[pd_index] & ~0xFFF);
+  return &pt_virt[pt_index];
+}
+
+/* Writes a raw entry, e.g. a swap entry, into an existing page table. */
+void set_page_entry(uint32_t* page_directory, uint32_t virtual_addr, uint32_t entry) {
+  uint32_t* pte = get_page_entry(page_directory, virtual_addr);
+  if (pte == NULL) {
+    return;
+  }
+
+  update_rmap(page_directory, virtual_addr, *pte, entry);
+  *pte = entry;
+
+  asm volatile("invlpg (%0)" :: "r"(virtual_addr) : "memory");
+}
+
+/*
+ * Maps frame read-only for user mode at KERNEL_VDSO_START. The page table is
+ * part of the kernel half, so every page directory created afterwards shares
+ * the mapping. Returns the address, or 0 on failure.
+ */
+uint32_t map_vdso_page(uint32_t frame) {
+  uint32_t pt_phys = alloc_frame();
+  if (pt_phys == 0) {
+    return 0;
+  }
+
+  uint32_t* page_table = (uint32_t*)phys_to_virt(pt_phys);
+  memset(page_table, 0, FRAME_SIZE);
+  page_table[0] = frame | PAGE_PRESENT | PAGE_USER;
+
+  kernel_page_directory[KERNEL_VDSO_PDT_IDX] = pt_phys | PAGE_PRESENT | PAGE_USER;
+  asm volatile("invlpg (%0)" ::"r"(KERNEL_VDSO_START) : "memory");
+  return KERNEL_VDSO_START;
+}
@@ -1,43 +1,374 @@
 #include "mem/process.h"
-#include "arch/x86/tss.h"
 #include "lib/log.h"
 #include "lib/string.h"
+#include "mem/kheap.h"
 #include "mem/page_frame_allocator.h"
 #include "mem/paging.h"
+#include "sched/sched.h"
 
 #include <stddef.h>
 #include <stdint.h>
 
-static uint32_t next_pid = 1;
-static process_t process_table[MAX_PROCESSES];
+/*
+ * PCBs are allocated from the kernel heap on demand and recycled through a
+ * free list, so the number of processes is bounded by memory rather than a
+ * table size. Live PCBs are found by PID through a hash, and each parent
+ * keeps its live and exited children on intrusive lists so fork, exit and
+ * wait never scan every process.
+ */
+static process_t* free_pcbs = NULL;
+/* Exited tasks without a parent to wait for them, linked through sibling_next until they are freed. */
+static process_t* orphan_zombies = NULL;
+static process_t* pid_hash[PID_HASH_BUCKETS];
+static uint32_t pid_bitmap[PID_MAX / 32];
+static uint32_t last_pid = 0;
+static uint32_t num_processes = 0;
+static uint32_t max_processes = 0;
 
 process_t* current_process = NULL;
-process_t* ready_queue_head = NULL;
+
+extern void interrupt_return(void);
+void kernel_idle(void);
+
+static process_t** pid_bucket(uint32_t pid) { return &pid_hash[pid % PID_HASH_BUCKETS]; }
+
+/* Next free PID after the last one handed out, wrapping around, so recently freed PIDs are not reused at once. */
+static uint32_t alloc_pid(void) {
+  uint32_t pid = (last_pid + 1) % PID_MAX;
+
+  for (uint32_t scanned = 0; scanned <= PID_MAX / 32; scanned++) {
+    uint32_t word = pid / 32;
+    uint32_t free_bits = ~pid_bitmap[word] & (0xFFFFFFFF << (pid % 32));
+    if (free_bits) {
+      pid = word * 32 + __builtin_ctz(free_bits);
+      pid_bitmap[word] |= 1u << (pid % 32);
+      last_pid = pid;
+      return pid;
+    }
+    pid = ((word + 1) * 32) % PID_MAX;
+  }
+  return 0;
+}
+
+static void release_pid(uint32_t pid) { pid_bitmap[pid / 32] &= ~(1u << (pid % 32)); }
+
+static process_t** sibling_list(process_t* proc) {
+  return proc->state == PROCESS_STATE_TERMINATED ? &proc->parent->zombies : &proc->parent->children;
+}
+
+static void link_sibling(process_t* proc) {
+  process_t** head = sibling_list(proc);
+
+  proc->sibling_prev = NULL;
+  proc->sibling_next = *head;
+  if (*head) {
+    (*head)->sibling_prev = proc;
+  }
+  *head = proc;
+}
+
+static void unlink_sibling(process_t* proc) {
+  if (proc->sibling_prev) {
+    proc->sibling_prev->sibling_next = proc->sibling_next;
+  } else {
+    *sibling_list(proc) = proc->sibling_next;
+  }
+  if (proc->sibling_next) {
+    proc->sibling_next->sibling_prev = proc->sibling_prev;
+  }
+  proc->sibling_next = NULL;
+  proc->sibling_prev = NULL;
+}
+
+/* Frees every parentless zombie except the current task, which is still running on its kernel stack. */
+static void reap_orphans(void) {
+  process_t** link = &orphan_zombies;
+  while (*link) {
+    process_t* proc = *link;
+    if (proc == current_process || !process_reapable(proc)) {
+      link = &proc->sibling_next;
+      continue;
+    }
+    *link = proc->sibling_next;
+    proc->sibling_next = NULL;
+    process_free(proc);
+  }
+}
 
 process_t* allocate_pcb_and_pid(uint32_t* new_pid) {
-  for (int i = 0; i < MAX_PROCESSES; ++i) {
-    if (process_table[i].state == PROCESS_STATE_FREE) {
-      *new_pid = next_pid++;
-      process_table[i].pid = *new_pid;
-      memset(&process_table[i].context, 0, sizeof(process_context_t));
-      memset(process_table[i].kstack, 0xCD, PROCESS_KERNEL_STACK_SIZE);
-      return &process_table[i];
+  reap_orphans();
+
+  if (num_processes >= max_processes) {
+    LOG_ERROR("Process limit of %d reached", max_processes);
+    return NULL;
+  }
+
+  process_t* proc = free_pcbs;
+  if (proc) {
+    free_pcbs = proc->hash_next;
+  } else {
+    proc = kmalloc(sizeof(process_t));
+    if (proc == NULL) {
+      LOG_ERROR("No memory for a new PCB");
+      return NULL;
+    }
+  }
+
+  uint32_t pid = alloc_pid();
+  if (pid == 0) {
+    LOG_ERROR("No free PIDs available!");
+    proc->hash_next = free_pcbs;
+    free_pcbs = proc;
+    return NULL;
+  }
+
+  memset(proc, 0, sizeof(process_t));
+  memset(proc->kstack, 0xCD, PROCESS_KERNEL_STACK_SIZE);
+  proc->pid = pid;
+  proc->state = PROCESS_STATE_FREE;
+  proc->leader = proc;
+  proc->mm_users = 1;
+  proc->mm_live = 1;
+  sched_init_task(proc, 0);
+  wait_queue_init(&proc->child_exit);
+
+  process_t** bucket = pid_bucket(pid);
+  proc->hash_next = *bucket;
+  *bucket = proc;
+  num_processes++;
+
+  *new_pid = pid;
+  return proc;
+}
+
+/*
+ * Puts a PCB that is no longer running or queued back on the free list. Its
+ * live children are orphaned and its unreaped ones freed with it, since
+ * nobody is left to wait for them; a leader whose threads still run is
+ * reaped as an orphan later. The last task using an address space releases
+ * it.
+ */
+void process_free(process_t* proc) {
+  if (proc->parent) {
+    unlink_sibling(proc);
+    proc->parent = NULL;
+  }
+  while (proc->children) {
+    process_t* child = proc->children;
+    unlink_sibling(child);
+    child->parent = NULL;
+  }
+  while (proc->zombies) {
+    process_t* zombie = proc->zombies;
+    if (process_reapable(zombie)) {
+      process_free(zombie);
+      continue;
+    }
+    unlink_sibling(zombie);
+    zombie->parent = NULL;
+    zombie->sibling_next = orphan_zombies;
+    orphan_zombies = zombie;
+  }
+
+  process_t** link = pid_bucket(proc->pid);
+  while (*link && *link != proc) {
+    link = &(*link)->hash_next;
+  }
+  if (*link) {
+    *link = proc->hash_next;
+  }
+
+  release_pid(proc->pid);
+  proc->pid = 0;
+  proc->state = PROCESS_STATE_FREE;
+  num_processes--;
+
+  /* A leader's PCB holds the address space, so it stays allocated until its last thread is gone. */
+  process_t* leader = proc->leader;
+  if (leader != proc) {
+    proc->hash_next = free_pcbs;
+    free_pcbs = proc;
+  }
+  if (--leader->mm_users == 0) {
+    if (leader->context.cr3) {
+      vm_release_address_space(leader);
+    }
+    leader->hash_next = free_pcbs;
+    free_pcbs = leader;
+  }
+}
+
+void process_set_parent(process_t* proc, process_t* parent) {
+  if (proc->parent) {
+    unlink_sibling(proc);
+  }
+  proc->parent = parent;
+  if (parent) {
+    link_sibling(proc);
+  }
+}
+
+process_t* get_zombie_process_for_parent(process_t* parent) { return parent->zombies; }
+
+/*
+ * An exited task can be freed, unless it leads a thread group with threads
+ * still running on its address space; it then stays a zombie until the last
+ * of them exits.
+ */
+bool process_reapable(process_t* proc) {
+  return proc->state == PROCESS_STATE_TERMINATED && (proc->leader != proc || proc->mm_live == 0);
+}
+
+/* Finds a child of parent with the given pid, or any child for WAIT_ANY_CHILD, preferring one that can be reaped. */
+process_t* get_child_process(process_t* parent, uint32_t pid) {
+  if (pid == WAIT_ANY_CHILD) {
+    for (process_t* zombie = parent->zombies; zombie; zombie = zombie->sibling_next) {
+      if (process_reapable(zombie)) {
+        return zombie;
+      }
+    }
+    return parent->children ? parent->children : parent->zombies;
+  }
+
+  process_t* proc = get_process_by_pid(pid);
+  return proc && proc->parent == parent ? proc : NULL;
+}
+
+process_t* get_process_by_pid(uint32_t pid) {
+  if (pid == 0 || pid >= PID_MAX) {
+    return NULL;
+  }
+
+  for (process_t* proc = *pid_bucket(pid); proc; proc = proc->hash_next) {
+    if (proc->pid == pid) {
+      return proc;
     }
   }
-  LOG_ERROR("No free PCBs available!");
   return NULL;
 }
 
-process_t* get_zombie_process_for_parent(uint32_t parent_pid) {
-  for (int i = 0; i < MAX_PROCESSES; i++) {
-    if (process_table[i].state == PROCESS_STATE_TERMINATED &&
-        process_table[i].parent_pid == parent_pid) {
-      return &process_table[i];
+/* The live process with the lowest PID at or above min_pid, found through the PID bitmap. */
+process_t* get_next_process(uint32_t min_pid) {
+  for (uint32_t pid = min_pid ? min_pid : 1; pid < PID_MAX;) {
+    uint32_t word = pid / 32;
+    uint32_t used = pid_bitmap[word] & (0xFFFFFFFF << (pid % 32));
+    if (used) {
+      return get_process_by_pid(word * 32 + __builtin_ctz(used));
     }
+    pid = (word + 1) * 32;
   }
   return NULL;
 }
 
+void for_each_process(void (*fn)(process_t* proc)) {
+  for (process_t* proc = get_next_process(1); proc; proc = get_next_process(proc->pid + 1)) {
+    fn(proc);
+  }
+}
+
+int process_install_fd(process_t* proc, fs_descriptor_t* desc) {
+  for (int fd = 0; fd < PROCESS_MAX_FILES; fd++) {
+    if (!proc->files[fd].used) {
+      proc->files[fd].used = true;
+      proc->files[fd].desc = *desc;
+      return fd;
+    }
+  }
+  LOG_ERROR("PID %d has no free file descriptors", proc->pid);
+  return -1;
+}
+
+fs_descriptor_t* process_get_fd(process_t* proc, int fd) {
+  if (fd < 0 || fd >= PROCESS_MAX_FILES || !proc->files[fd].used) {
+    return NULL;
+  }
+  return &proc->files[fd].desc;
+}
+
+int process_close_fd(process_t* proc, int fd) {
+  fs_descriptor_t* desc = process_get_fd(proc, fd);
+  if (desc == NULL) {
+    return -1;
+  }
+
+  close_file(desc);
+  proc->files[fd].used = false;
+  return 0;
+}
+
+/* Records the user registers a process trapped into the kernel with, e.g. for fork to copy. */
+void process_save_user_context(process_t* proc, cpu_state_t* regs, stack_state_t* frame) {
+  proc->context.reg = *regs;
+  proc->context.stack = *frame;
+}
+
+/*
+ * Lays out the frame common_interrupt_handler would have left for context at
+ * the top of the kernel stack, below it the callee-saved registers
+ * switch_stacks pops, so the first switch to proc leaves through
+ * interrupt_return and irets into context.stack.
+ */
+void process_prepare_iret_frame(process_t* proc) {
+  uint32_t* kstack_ptr = (uint32_t*)((uintptr_t)proc->kstack + PROCESS_KERNEL_STACK_SIZE);
+
+  if (proc->context.stack.cs == USER_CS_SELECTOR) {
+    *--kstack_ptr = proc->context.stack.ss;
+    *--kstack_ptr = proc->context.stack.esp;
+  } else {
+    *--kstack_ptr = (uint32_t)kernel_idle;
+  }
+  *--kstack_ptr = proc->context.stack.eflags;
+  *--kstack_ptr = proc->context.stack.cs;
+  *--kstack_ptr = proc->context.stack.eip;
+  uint32_t iret_frame = (uint32_t)kstack_ptr;
+
+  *--kstack_ptr = 0; /* error code */
+  *--kstack_ptr = 0; /* interrupt index */
+
+  kstack_ptr -= sizeof(cpu_state_t) / sizeof(uint32_t);
+  cpu_state_t* regs = (cpu_state_t*)kstack_ptr;
+  *regs = proc->context.reg;
+  regs->esp = iret_frame;
+
+  *--kstack_ptr = (uint32_t)interrupt_return;
+  *--kstack_ptr = 0; /* ebp */
+  *--kstack_ptr = 0; /* ebx */
+  *--kstack_ptr = 0; /* esi */
+  *--kstack_ptr = 0; /* edi */
+
+  proc->kernel_esp = (uint32_t)kstack_ptr;
+}
+
+void process_exit(int status) {
+  LOG_INFO("Process %d exiting with status %d", current_process->pid, status);
+
+  current_process->context.reg.eax = status;
+  current_process->exit_status = status;
+  process_t* parent = current_process->parent;
+  if (parent) {
+    unlink_sibling(current_process);
+  }
+
+  /* The last thread out makes an exited leader reapable, so its parent has to look again. */
+  process_t* leader = current_process->leader;
+  if (--leader->mm_live == 0 && leader != current_process && leader->parent) {
+    wake_up_all(&leader->parent->child_exit);
+  }
+  current_process->state = PROCESS_STATE_TERMINATED;
+  sched_task_exit(current_process);
+
+  if (parent) {
+    link_sibling(current_process);
+    wake_up_all(&parent->child_exit);
+  } else {
+    reap_orphans();
+    current_process->sibling_next = orphan_zombies;
+    orphan_zombies = current_process;
+  }
+
+  schedule();
+}
+
 void kernel_idle(void) {
   while (1)
     __asm__("hlt");
@@ -45,15 +376,20 @@ void kernel_idle(void) {
 
 void init_process_manager(void) {
   LOG_INFO("Initializing process manager...");
-  for (int i = 0; i < MAX_PROCESSES; ++i) {
-    process_table[i].state = PROCESS_STATE_FREE;
-    process_table[i].pid = 0;
-    process_table[i].next_in_ready_queue = NULL;
+  memset(pid_hash, 0, sizeof(pid_hash));
+  memset(pid_bitmap, 0, sizeof(pid_bitmap));
+  pid_bitmap[0] = 1;
+  last_pid = 0;
+  num_processes = 0;
+
+  uint32_t share = get_total_frames() / PROCESS_MEMORY_SHARE * FRAME_SIZE;
+  max_processes = share / sizeof(process_t);
+  if (max_processes > PID_MAX - 1) {
+    max_processes = PID_MAX - 1;
   }
+
   current_process = NULL;
-  ready_queue_head = NULL;
-  next_pid = 1;
-  LOG_INFO("Process manager initialized. Process table has %d slots.", MAX_PROCESSES);
+  LOG_INFO("Process manager initialized. Up to %d processes (%d bytes per PCB).", max_processes, sizeof(process_t));
   LOG_LINE();
 }
 
@@ -70,7 +406,7 @@ process_t* create_process(void* module_data, uint32_t module_size) {
   uint32_t* page_dir_virtual = create_page_directory();
   if (page_dir_virtual == NULL) {
     LOG_ERROR("Failed to create page directory for PID %d", new_pid_val);
-    new_proc->state = PROCESS_STATE_FREE;
+    process_free(new_proc);
     return NULL;
   }
   new_proc->context.cr3 = virt_to_phys((uint32_t)page_dir_virtual);
@@ -91,7 +427,7 @@ process_t* create_process(void* module_data, uint32_t module_size) {
     uint32_t frame_phys = alloc_frame();
     if (frame_phys == 0) {
       LOG_ERROR("Failed to allocate frame for user code page %d", i);
-      new_proc->state = PROCESS_STATE_FREE;
+      process_free(new_proc);
       return NULL;
     }
 
@@ -131,32 +467,14 @@ process_t* create_process(void* module_data, uint32_t module_size) {
   LOG_DEBUG("  EFLAGS: 0x%x", new_proc->context.stack.eflags);
   LOG_DEBUG("  CR3: 0x%x (page directory physical)", new_proc->context.cr3);
 
-  uintptr_t stack_top_addr = (uintptr_t)new_proc->kstack + PROCESS_KERNEL_STACK_SIZE;
-  uint32_t* kstack_ptr = (uint32_t*)stack_top_addr;
+  process_prepare_iret_frame(new_proc);
 
-  LOG_DEBUG("Kernel stack setup for iret:");
+  LOG_DEBUG("Kernel stack setup:");
   LOG_DEBUG("  Kernel stack base: 0x%x", (uint32_t)new_proc->kstack);
-  LOG_DEBUG("  Kernel stack top: 0x%x", stack_top_addr);
-
-  *--kstack_ptr = new_proc->context.stack.ss;
-  *--kstack_ptr = new_proc->context.stack.esp;
-  *--kstack_ptr = new_proc->context.stack.eflags;
-  *--kstack_ptr = new_proc->context.stack.cs;
-  *--kstack_ptr = new_proc->context.stack.eip;
-
-  LOG_DEBUG("  Stack contents (for iret):");
-  LOG_DEBUG("    [0x%x] SS: 0x%x", (uint32_t)(kstack_ptr + 4), new_proc->context.stack.ss);
-  LOG_DEBUG("    [0x%x] ESP: 0x%x", (uint32_t)(kstack_ptr + 3), new_proc->context.stack.esp);
-  LOG_DEBUG("    [0x%x] EFLAGS: 0x%x", (uint32_t)(kstack_ptr + 2), new_proc->context.stack.eflags);
-  LOG_DEBUG("    [0x%x] CS: 0x%x", (uint32_t)(kstack_ptr + 1), new_proc->context.stack.cs);
-  LOG_DEBUG("    [0x%x] EIP: 0x%x", (uint32_t)kstack_ptr, new_proc->context.stack.eip);
-  LOG_DEBUG("  Final kernel ESP: 0x%x", (uint32_t)kstack_ptr);
-
-  new_proc->context.reg.esp = (uint32_t)kstack_ptr;
+  LOG_DEBUG("  Kernel stack top: 0x%x", (uint32_t)new_proc->kstack + PROCESS_KERNEL_STACK_SIZE);
+  LOG_DEBUG("  Initial kernel ESP: 0x%x", new_proc->kernel_esp);
 
-  new_proc->state = PROCESS_STATE_READY;
-  new_proc->next_in_ready_queue = ready_queue_head;
-  ready_queue_head = new_proc;
+  sched_enqueue(new_proc);
 
   return new_proc;
 }
@@ -174,7 +492,7 @@ process_t* create_kernel_process(void (*entry_point)(void)) {
   uint32_t* page_dir_virtual = create_page_directory();
   if (page_dir_virtual == NULL) {
     LOG_ERROR("Failed to create page directory for PID %d", new_pid_val);
-    new_proc->state = PROCESS_STATE_FREE;
+    process_free(new_proc);
     return NULL;
   }
   new_proc->context.cr3 = virt_to_phys((uint32_t)page_dir_virtual);
@@ -187,51 +505,43 @@ process_t* create_kernel_process(void (*entry_point)(void)) {
   new_proc->context.stack.esp = 0;
   new_proc->context.stack.ss = 0;
 
-  uintptr_t stack_top_addr = (uintptr_t)new_proc->kstack + PROCESS_KERNEL_STACK_SIZE;
-  uint32_t* kstack_ptr = (uint32_t*)stack_top_addr;
-
-  *--kstack_ptr = (uint32_t)kernel_idle;
-  *--kstack_ptr = new_proc->context.stack.eflags;
-  *--kstack_ptr = new_proc->context.stack.cs;
-  *--kstack_ptr = new_proc->context.stack.eip;
-
-  new_proc->context.reg.esp = (uint32_t)kstack_ptr;
-
-  new_proc->state = PROCESS_STATE_READY;
-  new_proc->next_in_ready_queue = ready_queue_head;
-  ready_queue_head = new_proc;
+  process_prepare_iret_frame(new_proc);
+  sched_enqueue(new_proc);
 
   return new_proc;
 }
 
-void schedule(void) {
-  if (current_process) {
-    LOG_DEBUG("schedule() called. Current PID: %d. Ready queue head PID: %d", current_process->pid,
-              ready_queue_head ? ready_queue_head->pid : 0);
-  } else {
-    LOG_DEBUG("schedule() called. No current process. Ready queue head PID: %d",
-              ready_queue_head ? ready_queue_head->pid : 0);
+/*
+ * Creates a user thread of creator's process. It shares the leader's page
+ * directory and memory areas, starts with a copy of creator's file table and
+ * enters user mode at entry on the stack at user_esp. A leader that exits
+ * keeps its PID as an unreapable zombie while its threads run on.
+ */
+process_t* create_thread(process_t* creator, uint32_t entry, uint32_t user_esp) {
+  uint32_t tid;
+  process_t* thread = allocate_pcb_and_pid(&tid);
+  if (thread == NULL) {
+    return NULL;
   }
 
-  if (ready_queue_head != NULL) {
-    LOG_DEBUG("Switching to process PID %d", ready_queue_head->pid);
-    current_process = ready_queue_head;
-    ready_queue_head = ready_queue_head->next_in_ready_queue;
-    current_process->state = PROCESS_STATE_RUNNING;
-    LOG_DEBUG("Switching to process PID %d", current_process->pid);
-
-    uint32_t kernel_stack_top = (uint32_t)current_process->kstack + PROCESS_KERNEL_STACK_SIZE;
-    tss_set_kernel_stack(kernel_stack_top);
-
-    LOG_DEBUG("Context switch details:");
-    LOG_DEBUG("  TSS kernel stack (ESP0): 0x%x", kernel_stack_top);
-    LOG_DEBUG("  Process kernel ESP: 0x%x", current_process->context.reg.esp);
-    LOG_DEBUG("  Target CR3: 0x%x", current_process->context.cr3);
-    LOG_DEBUG("  Target EIP: 0x%x", current_process->context.stack.eip);
-    LOG_DEBUG("  Target CS: 0x%x", current_process->context.stack.cs);
-    LOG_DEBUG("  Target user ESP: 0x%x", current_process->context.stack.esp);
-    LOG_DEBUG("  Target SS: 0x%x", current_process->context.stack.ss);
-
-    switch_to_process(current_process);
-  }
+  process_t* leader = creator->leader;
+  thread->leader = leader;
+  leader->mm_users++;
+  leader->mm_live++;
+
+  thread->context.cr3 = leader->context.cr3;
+  thread->context.stack.eip = entry;
+  thread->context.stack.cs = USER_CS_SELECTOR;
+  thread->context.stack.eflags = USER_EFLAGS;
+  thread->context.stack.esp = user_esp;
+  thread->context.stack.ss = USER_DS_SELECTOR;
+  memcpy(thread->files, creator->files, sizeof(thread->files));
+
+  sched_init_task(thread, sched_get_nice(creator));
+  process_set_parent(thread, creator);
+  process_prepare_iret_frame(thread);
+  sched_enqueue(thread);
+
+  LOG_INFO("PID %d created thread %d of PID %d", creator->pid, tid, leader->pid);
+  return thread;
 }
@@ -0,0 +1,132 @@
+#include "mem/rmap.h"
+#include "lib/log.h"
+#include "mem/kheap.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include <stddef.h>
+
+/*
+ * Every user PTE that maps a frame is recorded on that frame's chain as the
+ * page directory frame number and the virtual page. Entries are linked by
+ * 16-bit pool indices; index 0 terminates a chain, so a zeroed head array
+ * means no mappings. The pool is fixed at RMAP_MAX_ENTRIES - 1 mappings; once
+ * it runs out further mappings go untracked (logged once) and reclaim, KSM and
+ * page_idle simply do not see them.
+ */
+
+#define RMAP_NONE 0
+
+typedef struct {
+  uint32_t vaddr;
+  uint32_t dir;
+  uint16_t next;
+} rmap_entry_t;
+
+static rmap_entry_t* entries = NULL;
+static uint16_t* heads = NULL;
+static uint16_t free_head = RMAP_NONE;
+static uint32_t total_frames = 0;
+static bool exhausted_logged = false;
+
+void rmap_init(void) {
+  total_frames = get_total_frames();
+
+  heads = kzalloc(total_frames * sizeof(uint16_t));
+  entries = kmalloc(RMAP_MAX_ENTRIES * sizeof(rmap_entry_t));
+  if (heads == NULL || entries == NULL) {
+    LOG_ERROR("Failed to allocate reverse map");
+    kfree(heads);
+    kfree(entries);
+    heads = NULL;
+    entries = NULL;
+    return;
+  }
+
+  for (uint32_t i = RMAP_MAX_ENTRIES - 1; i > RMAP_NONE; i--) {
+    entries[i].next = free_head;
+    free_head = i;
+  }
+
+  LOG_INFO("Reverse map initialized (%d entries for %d frames)", RMAP_MAX_ENTRIES - 1, total_frames);
+}
+
+static uint32_t dir_index(uint32_t* page_dir) { return (uint32_t)page_dir / FRAME_SIZE; }
+
+void rmap_add(uint32_t frame, uint32_t* page_dir, uint32_t vaddr) {
+  uint32_t idx = frame / FRAME_SIZE;
+  if (heads == NULL || idx >= total_frames) {
+    return;
+  }
+
+  if (free_head == RMAP_NONE) {
+    if (!exhausted_logged) {
+      LOG_ERROR("Reverse map exhausted, frame 0x%x mapped at 0x%x is untracked", frame, vaddr);
+      exhausted_logged = true;
+    }
+    return;
+  }
+
+  uint16_t entry = free_head;
+  free_head = entries[entry].next;
+
+  entries[entry].vaddr = vaddr & ~0xFFF;
+  entries[entry].dir = dir_index(page_dir);
+  entries[entry].next = heads[idx];
+  heads[idx] = entry;
+}
+
+void rmap_remove(uint32_t frame, uint32_t* page_dir, uint32_t vaddr) {
+  uint32_t idx = frame / FRAME_SIZE;
+  if (heads == NULL || idx >= total_frames) {
+    return;
+  }
+
+  uint32_t dir = dir_index(page_dir);
+  uint16_t* link = &heads[idx];
+  while (*link != RMAP_NONE) {
+    rmap_entry_t* entry = &entries[*link];
+    if (entry->dir == dir && entry->vaddr == (vaddr & ~0xFFF)) {
+      uint16_t removed = *link;
+      *link = entry->next;
+      entry->next = free_head;
+      free_head = removed;
+      return;
+    }
+    link = &entry->next;
+  }
+}
+
+uint32_t rmap_count(uint32_t frame) {
+  uint32_t idx = frame / FRAME_SIZE;
+  uint32_t count = 0;
+  if (heads == NULL || idx >= total_frames) {
+    return 0;
+  }
+
+  for (uint16_t i = heads[idx]; i != RMAP_NONE; i = entries[i].next) {
+    count++;
+  }
+  return count;
+}
+
+uint32_t for_each_mapping(uint32_t frame, rmap_visitor_t visit, void* arg) {
+  uint32_t idx = frame / FRAME_SIZE;
+  uint32_t visited = 0;
+  if (heads == NULL || idx >= total_frames) {
+    return 0;
+  }
+
+  uint16_t i = heads[idx];
+  while (i != RMAP_NONE) {
+    uint16_t next = entries[i].next;
+    uint32_t* page_dir = (uint32_t*)(entries[i].dir * FRAME_SIZE);
+    uint32_t vaddr = entries[i].vaddr;
+
+    visited++;
+    if (!visit(page_dir, vaddr, get_page_entry(page_dir, vaddr), arg)) {
+      break;
+    }
+    i = next;
+  }
+  return visited;
+}
@@ -0,0 +1,158 @@
+#include "mem/shm.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "mem/kheap.h"
+#include "mem/mmap.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "mem/swap.h"
+#include <stddef.h>
+
+#define SHM_ID_SLOT_BITS 8
+
+static shm_segment_t segments[SHM_MAX_SEGMENTS];
+
+static int segment_id(shm_segment_t* seg) {
+  return (int)((seg->generation << SHM_ID_SLOT_BITS) | (uint32_t)(seg - segments));
+}
+
+static shm_segment_t* segment_by_id(int id) {
+  if (id < 0) {
+    return NULL;
+  }
+
+  uint32_t slot = (uint32_t)id & ((1 << SHM_ID_SLOT_BITS) - 1);
+  if (slot >= SHM_MAX_SEGMENTS) {
+    return NULL;
+  }
+
+  shm_segment_t* seg = &segments[slot];
+  if (!seg->used || seg->generation != ((uint32_t)id >> SHM_ID_SLOT_BITS)) {
+    return NULL;
+  }
+  return seg;
+}
+
+static shm_segment_t* segment_by_name(const char* name) {
+  for (int i = 0; i < SHM_MAX_SEGMENTS; i++) {
+    if (segments[i].used && segments[i].linked && strcmp(segments[i].name, name) == 0) {
+      return &segments[i];
+    }
+  }
+  return NULL;
+}
+
+static void release_frames(shm_segment_t* seg, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    unref_frame(seg->frames[i]);
+  }
+  kfree(seg->frames);
+  seg->frames = NULL;
+}
+
+int shm_create(const char* name, uint32_t size) {
+  if (name == NULL || strlen(name) == 0 || strlen(name) >= SHM_NAME_MAX) {
+    LOG_ERROR("shm_create: invalid segment name");
+    return -1;
+  }
+
+  if (size == 0 || size > SHM_MAX_SIZE) {
+    LOG_ERROR("shm_create: invalid size %d (max %d)", size, SHM_MAX_SIZE);
+    return -1;
+  }
+
+  if (segment_by_name(name)) {
+    LOG_ERROR("shm_create: segment %s already exists", name);
+    return -1;
+  }
+
+  shm_segment_t* seg = NULL;
+  for (int i = 0; i < SHM_MAX_SEGMENTS; i++) {
+    if (!segments[i].used) {
+      seg = &segments[i];
+      break;
+    }
+  }
+  if (seg == NULL) {
+    LOG_ERROR("shm_create: no free segment slots");
+    return -1;
+  }
+
+  uint32_t num_pages = (size + FRAME_SIZE - 1) / FRAME_SIZE;
+  seg->frames = kmalloc(num_pages * sizeof(uint32_t));
+  if (seg->frames == NULL) {
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < num_pages; i++) {
+    uint32_t frame = alloc_user_frame(i * FRAME_SIZE);
+    if (frame == 0) {
+      LOG_ERROR("shm_create: out of memory for segment %s", name);
+      release_frames(seg, i);
+      return -1;
+    }
+    memset((void*)phys_to_virt(frame), 0, FRAME_SIZE);
+    seg->frames[i] = frame;
+  }
+
+  seg->used = true;
+  seg->linked = true;
+  strncpy(seg->name, name, SHM_NAME_MAX - 1);
+  seg->name[SHM_NAME_MAX - 1] = '\0';
+  seg->refcount = 1;
+  seg->num_pages = num_pages;
+
+  LOG_DEBUG("shm: created %s (%d pages) as id %d", seg->name, num_pages, segment_id(seg));
+  return segment_id(seg);
+}
+
+int shm_open(const char* name) {
+  if (name == NULL) {
+    return -1;
+  }
+
+  shm_segment_t* seg = segment_by_name(name);
+  return seg ? segment_id(seg) : -1;
+}
+
+uint32_t shm_map(process_t* proc, int id, uint32_t prot) {
+  shm_segment_t* seg = segment_by_id(id);
+  if (seg == NULL) {
+    LOG_ERROR("shm_map: no segment with id %d", id);
+    return 0;
+  }
+
+  return vm_map_shm(proc, seg, prot);
+}
+
+int shm_unlink(const char* name) {
+  shm_segment_t* seg = name ? segment_by_name(name) : NULL;
+  if (seg == NULL) {
+    return -1;
+  }
+
+  seg->linked = false;
+  shm_put(seg);
+  return 0;
+}
+
+void shm_get(shm_segment_t* seg) { seg->refcount++; }
+
+/* Mapped pages hold their own frame references, so they outlive the segment itself. */
+void shm_put(shm_segment_t* seg) {
+  if (--seg->refcount > 0) {
+    return;
+  }
+
+  LOG_DEBUG("shm: destroying %s", seg->name);
+  release_frames(seg, seg->num_pages);
+  seg->used = false;
+  seg->name[0] = '\0';
+  seg->num_pages = 0;
+  seg->generation = (seg->generation + 1) & 0xFFFF;
+}
+
+uint32_t shm_page_frame(shm_segment_t* seg, uint32_t page_idx) {
+  return page_idx < seg->num_pages ? seg->frames[page_idx] : 0;
+}
@@ -0,0 +1,72 @@
+#include "mem/soft_dirty.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "mem/swap.h"
+
+/*
+ * The hardware dirty bit doubles as the soft-dirty bit: clearing it (and the
+ * TLB entry) means the next write sets it again without taking a fault.
+ * Swapped pages keep it in their swap slot. The fault paths map new pages with
+ * it already set, so a page that was dropped or remapped and faulted back in
+ * counts as changed even if it is only read.
+ */
+
+bool soft_dirty_test(uint32_t pte) {
+  if (pte & PAGE_PRESENT) {
+    return (pte & PAGE_DIRTY) != 0;
+  }
+  return (swap_entry_flags(pte) & PAGE_DIRTY) != 0;
+}
+
+void soft_dirty_clear(process_t* proc) {
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+  bool is_current = proc == current_process;
+
+  for (uint32_t pde_idx = 0; pde_idx < KERNEL_PDT_IDX; pde_idx++) {
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(page_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE; pte_idx++) {
+      uint32_t pte = page_table[pte_idx];
+
+      if (is_swap_entry(pte)) {
+        swap_clear_entry_flags(pte, PAGE_DIRTY);
+        continue;
+      }
+      if (!(pte & PAGE_PRESENT) || !(pte & PAGE_DIRTY)) {
+        continue;
+      }
+
+      page_table[pte_idx] = pte & ~PAGE_DIRTY;
+      if (is_current) {
+        uint32_t virt_addr = (pde_idx << 22) | (pte_idx << 12);
+        asm volatile("invlpg (%0)" ::"r"(virt_addr) : "memory");
+      }
+    }
+  }
+}
+
+/* Fills addrs with up to max soft-dirty user pages at or above start and returns how many were found. */
+uint32_t soft_dirty_collect(process_t* proc, uint32_t start, uint32_t* addrs, uint32_t max) {
+  uint32_t* page_dir = (uint32_t*)phys_to_virt(proc->context.cr3);
+  uint32_t count = 0;
+
+  for (uint32_t pde_idx = start >> 22; pde_idx < KERNEL_PDT_IDX && count < max; pde_idx++) {
+    if (!(page_dir[pde_idx] & PAGE_PRESENT)) {
+      continue;
+    }
+
+    uint32_t* page_table = (uint32_t*)phys_to_virt(page_dir[pde_idx] & ~0xFFF);
+    for (uint32_t pte_idx = 0; pte_idx < PAGE_TABLE_SIZE && count < max; pte_idx++) {
+      uint32_t virt_addr = (pde_idx << 22) | (pte_idx << 12);
+      if (virt_addr >= start && soft_dirty_test(page_table[pte_idx])) {
+        addrs[count++] = virt_addr;
+      }
+    }
+  }
+
+  return count;
+}
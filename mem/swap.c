@@ -0,0 +1,338 @@
+#include "mem/swap.h"
+#include "lib/log.h"
+#include "lib/lz.h"
+#include "lib/string.h"
+#include "mem/kheap.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "mem/rmap.h"
+#include <stddef.h>
+
+/*
+ * Anonymous pages owned by a single mapping sit on an LRU indexed by frame
+ * number. Reclaim walks it from the cold end, finds the mapping through the
+ * reverse map, gives accessed pages a second chance, and compresses victims
+ * into kmalloc'd blobs. The idle page scanner clears accessed bits too, so it
+ * hands what it harvests to the LRU as a referenced flag. The PTE of a swapped
+ * page is left non-present with PAGE_SWAPPED set and the slot index in the
+ * frame bits.
+ */
+
+#define LRU_NONE 0xFFFFFFFF
+
+typedef struct {
+  bool linked;
+  bool referenced;
+  uint32_t prev;
+  uint32_t next;
+} lru_node_t;
+
+typedef struct {
+  bool used;
+  uint16_t size;
+  uint16_t flags;
+  void* data;
+} swap_slot_t;
+
+static lru_node_t* lru_nodes = NULL;
+static uint32_t lru_head = LRU_NONE;
+static uint32_t lru_tail = LRU_NONE;
+
+static swap_slot_t swap_slots[SWAP_MAX_SLOTS];
+static uint32_t next_free_slot = 0;
+static uint8_t compress_buffer[SWAP_MAX_COMPRESSED];
+
+static uint32_t stored_pages = 0;
+static uint32_t stored_bytes = 0;
+
+void swap_init(void) {
+  uint32_t total_frames = get_total_frames();
+
+  lru_nodes = kzalloc(total_frames * sizeof(lru_node_t));
+  if (lru_nodes == NULL) {
+    LOG_ERROR("Failed to allocate swap LRU, reclaim disabled");
+    return;
+  }
+
+  LOG_INFO("Compressed swap initialized (%d slots, %d frames tracked)", SWAP_MAX_SLOTS, total_frames);
+}
+
+static void lru_unlink(uint32_t idx) {
+  lru_node_t* node = &lru_nodes[idx];
+  if (!node->linked) {
+    return;
+  }
+
+  if (node->prev != LRU_NONE) {
+    lru_nodes[node->prev].next = node->next;
+  } else {
+    lru_head = node->next;
+  }
+  if (node->next != LRU_NONE) {
+    lru_nodes[node->next].prev = node->prev;
+  } else {
+    lru_tail = node->prev;
+  }
+  node->linked = false;
+}
+
+static void lru_push_head(uint32_t idx) {
+  lru_node_t* node = &lru_nodes[idx];
+
+  node->prev = LRU_NONE;
+  node->next = lru_head;
+  if (lru_head != LRU_NONE) {
+    lru_nodes[lru_head].prev = idx;
+  } else {
+    lru_tail = idx;
+  }
+  lru_head = idx;
+  node->linked = true;
+  node->referenced = false;
+}
+
+void swap_lru_add(uint32_t frame) {
+  if (lru_nodes == NULL) {
+    return;
+  }
+
+  uint32_t idx = frame / FRAME_SIZE;
+  lru_unlink(idx);
+  lru_push_head(idx);
+}
+
+/* Records an accessed bit cleared outside reclaim, so the page still gets its second chance. */
+void swap_lru_referenced(uint32_t frame) {
+  uint32_t idx = frame / FRAME_SIZE;
+  if (lru_nodes != NULL && idx < get_total_frames()) {
+    lru_nodes[idx].referenced = true;
+  }
+}
+
+bool is_swap_entry(uint32_t pte) { return !(pte & PAGE_PRESENT) && (pte & PAGE_SWAPPED); }
+
+static int alloc_slot(void) {
+  for (uint32_t i = 0; i < SWAP_MAX_SLOTS; i++) {
+    uint32_t slot = (next_free_slot + i) % SWAP_MAX_SLOTS;
+    if (!swap_slots[slot].used) {
+      next_free_slot = (slot + 1) % SWAP_MAX_SLOTS;
+      swap_slots[slot].used = true;
+      return slot;
+    }
+  }
+  return -1;
+}
+
+static void free_slot(uint32_t slot) {
+  swap_slot_t* entry = &swap_slots[slot];
+
+  stored_pages--;
+  stored_bytes -= entry->size;
+  kfree(entry->data);
+  memset(entry, 0, sizeof(swap_slot_t));
+}
+
+static bool is_zero_page(const uint32_t* words) {
+  for (uint32_t i = 0; i < FRAME_SIZE / sizeof(uint32_t); i++) {
+    if (words[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+typedef struct {
+  uint32_t* page_dir;
+  uint32_t vaddr;
+  uint32_t* pte;
+} swap_mapping_t;
+
+static bool record_mapping(uint32_t* page_dir, uint32_t vaddr, uint32_t* pte, void* arg) {
+  swap_mapping_t* mapping = arg;
+  mapping->page_dir = page_dir;
+  mapping->vaddr = vaddr;
+  mapping->pte = pte;
+  return false;
+}
+
+/* Finds the only mapping of the frame if it is still an exclusively owned anonymous page. */
+static bool lru_owner_mapping(uint32_t idx, swap_mapping_t* mapping) {
+  uint32_t frame = idx * FRAME_SIZE;
+  if (frame_refcount(frame) != 1 || rmap_count(frame) != 1) {
+    return false;
+  }
+
+  for_each_mapping(frame, record_mapping, mapping);
+
+  uint32_t* pte = mapping->pte;
+  if (pte == NULL || (*pte & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+    return false;
+  }
+  return (*pte & ~0xFFF) == frame && !(*pte & (PAGE_SHARED | PAGE_COW));
+}
+
+static void restore_page(uint32_t* page_dir, uint32_t vaddr, uint32_t slot, uint32_t size) {
+  uint32_t frame = alloc_frame();
+  if (frame == 0) {
+    LOG_ERROR("Swap: lost page 0x%x of page directory 0x%x", vaddr, page_dir);
+    return;
+  }
+
+  void* frame_virt = (void*)phys_to_virt(frame);
+  if (size == 0) {
+    memset(frame_virt, 0, FRAME_SIZE);
+  } else {
+    lz_decompress(compress_buffer, size, frame_virt, FRAME_SIZE);
+  }
+
+  map_page(page_dir, vaddr, frame, swap_slots[slot].flags | PAGE_PRESENT);
+  memset(&swap_slots[slot], 0, sizeof(swap_slot_t));
+  swap_lru_add(frame);
+}
+
+/* Compresses the page at the cold end of the LRU. Returns true if its frame was released. */
+static bool evict_page(uint32_t idx) {
+  swap_mapping_t mapping = {NULL, 0, NULL};
+  if (!lru_owner_mapping(idx, &mapping)) {
+    lru_unlink(idx);
+    return false;
+  }
+
+  uint32_t* pte = mapping.pte;
+  uint32_t vaddr = mapping.vaddr;
+  uint32_t* page_dir = mapping.page_dir;
+
+  if ((*pte & PAGE_ACCESSED) || lru_nodes[idx].referenced) {
+    set_page_entry(page_dir, vaddr, *pte & ~PAGE_ACCESSED);
+    lru_unlink(idx);
+    lru_push_head(idx);
+    return false;
+  }
+
+  const uint8_t* page = (const uint8_t*)phys_to_virt(idx * FRAME_SIZE);
+  int size = 0;
+  if (!is_zero_page((const uint32_t*)page)) {
+    size = lz_compress(page, FRAME_SIZE, compress_buffer, SWAP_MAX_COMPRESSED);
+    if (size <= 0) {
+      lru_unlink(idx);
+      lru_push_head(idx);
+      return false;
+    }
+  }
+
+  int slot = alloc_slot();
+  if (slot < 0) {
+    return false;
+  }
+
+  swap_slots[slot].size = size;
+  swap_slots[slot].flags = *pte & 0xFFF & ~(PAGE_PRESENT | PAGE_ACCESSED);
+
+  lru_unlink(idx);
+  set_page_entry(page_dir, vaddr, ((uint32_t)slot << 12) | PAGE_SWAPPED);
+  unref_frame(idx * FRAME_SIZE);
+
+  /* The victim's frame is free again, so a new slab for the blob can always be found. */
+  if (size > 0) {
+    swap_slots[slot].data = kmalloc(size);
+    if (swap_slots[slot].data == NULL) {
+      restore_page(page_dir, vaddr, slot, size);
+      return false;
+    }
+    memcpy(swap_slots[slot].data, compress_buffer, size);
+  }
+
+  stored_pages++;
+  stored_bytes += size;
+  return true;
+}
+
+uint32_t swap_reclaim(uint32_t target) {
+  uint32_t reclaimed = 0;
+
+  if (lru_nodes == NULL) {
+    return 0;
+  }
+
+  for (uint32_t scanned = 0; scanned < SWAP_MAX_SCAN && reclaimed < target && lru_tail != LRU_NONE; scanned++) {
+    if (evict_page(lru_tail)) {
+      reclaimed++;
+    }
+  }
+
+  LOG_DEBUG("Swap: reclaimed %d pages (%d stored in %d compressed bytes)", reclaimed, stored_pages, stored_bytes);
+  return reclaimed;
+}
+
+uint32_t alloc_user_frame(uint32_t vaddr) {
+  uint32_t frame = alloc_frame_coloured(vaddr);
+  if (frame != 0) {
+    return frame;
+  }
+
+  if (swap_reclaim(SWAP_RECLAIM_BATCH) == 0) {
+    return 0;
+  }
+  return alloc_frame_coloured(vaddr);
+}
+
+vm_fault_t swap_in(process_t* proc, uint32_t vaddr) {
+  uint32_t page_addr = vaddr & ~0xFFF;
+  uint32_t* page_dir = (uint32_t*)proc->context.cr3;
+
+  uint32_t* pte = get_page_entry(page_dir, page_addr);
+  if (pte == NULL || !is_swap_entry(*pte)) {
+    return VM_FAULT_NO_AREA;
+  }
+
+  uint32_t slot = *pte >> 12;
+  if (slot >= SWAP_MAX_SLOTS || !swap_slots[slot].used) {
+    LOG_ERROR("Swap: PID %d has a bad swap entry 0x%x at 0x%x", proc->pid, *pte, page_addr);
+    return VM_FAULT_SIGSEGV;
+  }
+
+  uint32_t frame = alloc_user_frame(page_addr);
+  if (frame == 0) {
+    return VM_FAULT_OOM;
+  }
+
+  swap_slot_t* entry = &swap_slots[slot];
+  void* frame_virt = (void*)phys_to_virt(frame);
+  if (entry->size == 0) {
+    memset(frame_virt, 0, FRAME_SIZE);
+  } else if (lz_decompress(entry->data, entry->size, frame_virt, FRAME_SIZE) != FRAME_SIZE) {
+    LOG_ERROR("Swap: corrupt slot %d for page 0x%x of PID %d", slot, page_addr, proc->pid);
+    free_frame(frame);
+    return VM_FAULT_SIGSEGV;
+  }
+
+  map_page(page_dir, page_addr, frame, entry->flags | PAGE_PRESENT);
+  free_slot(slot);
+  swap_lru_add(frame);
+
+  return VM_FAULT_HANDLED;
+}
+
+void swap_free_entry(uint32_t pte) {
+  uint32_t slot = pte >> 12;
+  if (is_swap_entry(pte) && slot < SWAP_MAX_SLOTS && swap_slots[slot].used) {
+    free_slot(slot);
+  }
+}
+
+/* Flags the page will be mapped with on swap-in; PAGE_DIRTY carries the soft-dirty state while swapped. */
+uint32_t swap_entry_flags(uint32_t pte) {
+  uint32_t slot = pte >> 12;
+  if (!is_swap_entry(pte) || slot >= SWAP_MAX_SLOTS || !swap_slots[slot].used) {
+    return 0;
+  }
+  return swap_slots[slot].flags;
+}
+
+void swap_clear_entry_flags(uint32_t pte, uint32_t flags) {
+  uint32_t slot = pte >> 12;
+  if (is_swap_entry(pte) && slot < SWAP_MAX_SLOTS && swap_slots[slot].used) {
+    swap_slots[slot].flags &= ~flags;
+  }
+}
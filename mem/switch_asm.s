@@ -1,24 +1,24 @@
 section .text
-global switch_to_process
+global switch_stacks
 
-; void switch_to_process(process_t* next)
-switch_to_process:
+; void switch_stacks(uint32_t* prev_esp, uint32_t next_esp)
+; Saves the callee-saved registers on the current kernel stack, stores its
+; esp in *prev_esp and resumes the stack saved in next_esp.
+switch_stacks:
     mov     eax, [esp + 4]
+    mov     edx, [esp + 8]
 
-    ; Load cr3
-    mov     ecx, [eax + 0x3C]
-    mov     cr3, ecx
+    push    ebp
+    push    ebx
+    push    esi
+    push    edi
 
-    mov     esp, [eax + 0x24]
+    mov     [eax], esp
+    mov     esp, edx
 
-    ; Restore registers
-    mov     edi, [eax + 0x08]
-    mov     esi, [eax + 0x0C]
-    mov     ebp, [eax + 0x10]
-    mov     edx, [eax + 0x14]
-    mov     ecx, [eax + 0x18]
-    mov     ebx, [eax + 0x1C]
-    mov     eax, [eax + 0x20]
+    pop     edi
+    pop     esi
+    pop     ebx
+    pop     ebp
 
-    ; Return into process
-    iret
+    ret
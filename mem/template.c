@@ -0,0 +1,124 @@
+#include "mem/template.h"
+#include "arch/x86/gdt.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "mem/kheap.h"
+#include "mem/mmap.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include <stddef.h>
+
+static process_template_t templates[MAX_TEMPLATES];
+
+static process_template_t* template_by_id(int id) {
+  if (id < 1 || id > MAX_TEMPLATES || !templates[id - 1].used) {
+    return NULL;
+  }
+  return &templates[id - 1];
+}
+
+int template_create(process_t* proc) {
+  process_template_t* tmpl = NULL;
+  for (int i = 0; i < MAX_TEMPLATES; i++) {
+    if (!templates[i].used) {
+      tmpl = &templates[i];
+      break;
+    }
+  }
+  if (tmpl == NULL) {
+    LOG_ERROR("template: no free template slots");
+    return -1;
+  }
+
+  process_t* image = kzalloc(sizeof(process_t));
+  if (image == NULL) {
+    return -1;
+  }
+
+  uint32_t* page_dir = create_page_directory();
+  if (page_dir == NULL) {
+    kfree(image);
+    return -1;
+  }
+  image->context.cr3 = virt_to_phys((uint32_t)page_dir);
+  image->leader = image;
+
+  if (vm_share_address_space(image, proc) != 0) {
+    LOG_ERROR("template: failed to snapshot PID %d", proc->pid);
+    vm_release_address_space(image);
+    kfree(image);
+    return -1;
+  }
+
+  image->state = PROCESS_STATE_BLOCKED;
+  image->context.reg = proc->context.reg;
+  image->context.stack = proc->context.stack;
+  image->context.reg.eax = 0;
+  image->gs = proc == current_process ? read_gs() : proc->gs;
+  image->tls_base = proc->tls_base;
+  memcpy(image->files, proc->files, sizeof(image->files));
+
+  tmpl->used = true;
+  tmpl->source_pid = proc->pid;
+  tmpl->image = image;
+
+  int id = (tmpl - templates) + 1;
+  LOG_INFO("template: PID %d saved as template %d (eip 0x%x)", proc->pid, id, image->context.stack.eip);
+  return id;
+}
+
+process_t* template_spawn(int id, uint32_t parent_pid) {
+  process_template_t* tmpl = template_by_id(id);
+  if (tmpl == NULL) {
+    LOG_ERROR("template: no template with id %d", id);
+    return NULL;
+  }
+
+  uint32_t new_pid;
+  process_t* proc = allocate_pcb_and_pid(&new_pid);
+  if (proc == NULL) {
+    return NULL;
+  }
+
+  uint32_t* page_dir = create_page_directory();
+  if (page_dir == NULL) {
+    process_free(proc);
+    return NULL;
+  }
+  proc->context.cr3 = virt_to_phys((uint32_t)page_dir);
+
+  if (vm_share_address_space(proc, tmpl->image) != 0) {
+    vm_release_address_space(proc);
+    process_free(proc);
+    return NULL;
+  }
+
+  process_t* image = tmpl->image;
+  process_set_parent(proc, get_process_by_pid(parent_pid));
+  proc->context.reg = image->context.reg;
+  proc->context.stack = image->context.stack;
+  proc->gs = image->gs;
+  proc->tls_base = image->tls_base;
+  memcpy(proc->files, image->files, sizeof(proc->files));
+
+  process_prepare_iret_frame(proc);
+  sched_enqueue(proc);
+
+  LOG_DEBUG("template: spawned PID %d from template %d", proc->pid, id);
+  return proc;
+}
+
+int template_destroy(int id) {
+  process_template_t* tmpl = template_by_id(id);
+  if (tmpl == NULL) {
+    return -1;
+  }
+
+  vm_release_address_space(tmpl->image);
+  kfree(tmpl->image);
+  memset(tmpl, 0, sizeof(process_template_t));
+
+  LOG_DEBUG("template: destroyed template %d", id);
+  return 0;
+}
@@ -0,0 +1,225 @@
+#include "mem/userfaultfd.h"
+#include "arch/x86/uaccess.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "lib/sys/errno.h"
+#include "mem/mmap.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/swap.h"
+#include <stddef.h>
+
+static userfaultfd_t userfaultfds[MAX_USERFAULTFDS];
+
+static userfaultfd_t* uffd_by_id(int id) {
+  if (id < 1 || id > MAX_USERFAULTFDS || !userfaultfds[id - 1].used) {
+    return NULL;
+  }
+  return &userfaultfds[id - 1];
+}
+
+int uffd_create(process_t* owner) {
+  for (int i = 0; i < MAX_USERFAULTFDS; i++) {
+    userfaultfd_t* ctx = &userfaultfds[i];
+    if (!ctx->used) {
+      memset(ctx, 0, sizeof(userfaultfd_t));
+      ctx->used = true;
+      ctx->owner_pid = owner->pid;
+      return i + 1;
+    }
+  }
+
+  LOG_ERROR("userfaultfd: no free descriptors");
+  return -ENOSPC;
+}
+
+/* Registers private anonymous memory, splitting areas at the range ends; its faults then stop at the descriptor. */
+int uffd_register(int id, uint32_t addr, uint32_t length) {
+  userfaultfd_t* ctx = uffd_by_id(id);
+  process_t* owner = ctx ? get_process_by_pid(ctx->owner_pid) : NULL;
+  if (owner == NULL) {
+    return -EBADF;
+  }
+
+  uint32_t end = addr + length;
+  if ((addr & (FRAME_SIZE - 1)) || (length & (FRAME_SIZE - 1)) || length == 0 || end < addr) {
+    return -EINVAL;
+  }
+
+  for (uint32_t page = addr; page < end; page += FRAME_SIZE) {
+    vm_area_t* area = vm_find_area(owner, page);
+    if (area == NULL || (area->flags & (MAP_ANONYMOUS | MAP_PRIVATE)) != (MAP_ANONYMOUS | MAP_PRIVATE) ||
+        (area->uffd != NULL && area->uffd != ctx)) {
+      LOG_ERROR("userfaultfd: 0x%x is not private anonymous memory of PID %d", page, owner->pid);
+      return -EINVAL;
+    }
+  }
+
+  if (vm_split_range(owner, addr, end) != 0) {
+    return -ENOMEM;
+  }
+
+  for (uint32_t page = addr; page < end;) {
+    vm_area_t* area = vm_find_area(owner, page);
+    area->uffd = ctx;
+    page = area->end;
+  }
+
+  LOG_DEBUG("userfaultfd %d: registered 0x%x - 0x%x of PID %d", id, addr, end, owner->pid);
+  return 0;
+}
+
+int uffd_read(int id, uffd_msg_t* msg) {
+  userfaultfd_t* ctx = uffd_by_id(id);
+  if (ctx == NULL) {
+    return -EBADF;
+  }
+
+  for (uint32_t i = 0; i < ctx->num_events; i++) {
+    if (!ctx->events[i].delivered) {
+      ctx->events[i].delivered = true;
+      *msg = ctx->events[i].msg;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void wake_range(userfaultfd_t* ctx, uint32_t start, uint32_t end) {
+  uint32_t i = 0;
+  while (i < ctx->num_events) {
+    uffd_msg_t* msg = &ctx->events[i].msg;
+    if (msg->address < start || msg->address >= end) {
+      i++;
+      continue;
+    }
+
+    process_t* proc = get_process_by_pid(msg->pid);
+    if (proc) {
+      sched_wake(proc);
+    }
+    ctx->events[i] = ctx->events[--ctx->num_events];
+  }
+}
+
+/* Maps fresh frames into the owner for [dst, dst + length), filled from src or zeroed when src is NULL. */
+static int resolve_range(int id, uint32_t dst, const void* src, uint32_t length) {
+  userfaultfd_t* ctx = uffd_by_id(id);
+  process_t* owner = ctx ? get_process_by_pid(ctx->owner_pid) : NULL;
+  if (owner == NULL) {
+    return -EBADF;
+  }
+
+  uint32_t end = dst + length;
+  if ((dst & (FRAME_SIZE - 1)) || (length & (FRAME_SIZE - 1)) || length == 0 || end < dst) {
+    return -EINVAL;
+  }
+
+  uint32_t* page_dir = (uint32_t*)owner->context.cr3;
+  int result = 0;
+
+  for (uint32_t page = dst; page < end; page += FRAME_SIZE) {
+    vm_area_t* area = vm_find_area(owner, page);
+    if (area == NULL || area->uffd != ctx) {
+      result = -EINVAL;
+      break;
+    }
+
+    uint32_t* pte = get_page_entry(page_dir, page);
+    if (pte && (*pte & (PAGE_PRESENT | PAGE_SWAPPED))) {
+      result = -EEXIST;
+      continue;
+    }
+
+    uint32_t frame = alloc_user_frame(page);
+    if (frame == 0) {
+      result = -ENOMEM;
+      break;
+    }
+
+    void* frame_virt = (void*)phys_to_virt(frame);
+    if (src == NULL) {
+      memset(frame_virt, 0, FRAME_SIZE);
+    } else if (copy_from_user(frame_virt, (const uint8_t*)src + (page - dst), FRAME_SIZE) != 0) {
+      free_frame(frame);
+      result = -EFAULT;
+      break;
+    }
+
+    uint32_t flags = PAGE_PRESENT | PAGE_USER | PAGE_DIRTY;
+    if (area->prot & PROT_WRITE) {
+      flags |= PAGE_RW;
+    }
+    map_page(page_dir, page, frame, flags);
+    swap_lru_add(frame);
+  }
+
+  wake_range(ctx, dst, end);
+  return result;
+}
+
+int uffd_copy(int id, uint32_t dst, const void* src, uint32_t length) {
+  if (src == NULL) {
+    return -EFAULT;
+  }
+  return resolve_range(id, dst, src, length);
+}
+
+int uffd_zeropage(int id, uint32_t dst, uint32_t length) { return resolve_range(id, dst, NULL, length); }
+
+/* Unregisters every area and releases blocked faulters, which then fault in zero pages as usual. */
+int uffd_close(int id) {
+  userfaultfd_t* ctx = uffd_by_id(id);
+  if (ctx == NULL) {
+    return -EBADF;
+  }
+
+  process_t* owner = get_process_by_pid(ctx->owner_pid);
+  if (owner) {
+    for (int i = 0; i < MAX_VM_AREAS; i++) {
+      if (process_vm_areas(owner)[i].uffd == ctx) {
+        process_vm_areas(owner)[i].uffd = NULL;
+      }
+    }
+  }
+
+  wake_range(ctx, 0, KERNEL_VIRTUAL_START);
+  ctx->used = false;
+  return 0;
+}
+
+static void queue_event(userfaultfd_t* ctx, process_t* proc, uint32_t page_addr, bool write) {
+  for (uint32_t i = 0; i < ctx->num_events; i++) {
+    if (ctx->events[i].msg.pid == proc->pid && ctx->events[i].msg.address == page_addr) {
+      return;
+    }
+  }
+
+  if (ctx->num_events == UFFD_MAX_EVENTS) {
+    LOG_WARN("userfaultfd: event queue full, PID %d will retry 0x%x", proc->pid, page_addr);
+    return;
+  }
+
+  uffd_event_t* event = &ctx->events[ctx->num_events++];
+  event->msg.pid = proc->pid;
+  event->msg.address = page_addr;
+  event->msg.flags = write ? UFFD_PAGEFAULT_FLAG_WRITE : 0;
+  event->delivered = false;
+}
+
+/*
+ * Called for a user-mode fault on a registered missing page. The process
+ * sleeps until UFFD_COPY or UFFD_ZEROPAGE wakes it, then returns from the
+ * fault and retries the faulting instruction.
+ */
+void uffd_handle_fault(process_t* proc, uint32_t addr, bool write) {
+  vm_area_t* area = vm_find_area(proc, addr);
+  if (area == NULL || area->uffd == NULL) {
+    return;
+  }
+
+  queue_event(area->uffd, proc, addr & ~0xFFF, write);
+
+  proc->state = PROCESS_STATE_BLOCKED;
+  schedule();
+}
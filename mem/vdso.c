@@ -0,0 +1,85 @@
+#include "mem/vdso.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/msr.h"
+#include "lib/log.h"
+#include "lib/string.h"
+#include "lib/sys/vdso.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include <stddef.h>
+
+/*
+ * The vDSO data page. It lives in the kernel half, under a page table whose
+ * only user-visible entry is this page, so every process gets it from the
+ * kernel page directory without any per-process mapping. The clock fields are
+ * rewritten on every timer resync and the PID on every context switch; with
+ * one CPU whoever is running always reads its own PID.
+ */
+
+static vdso_data_t* vdso_data = NULL;
+
+static void write_begin(void) {
+  vdso_data->seq++;
+  asm volatile("" : : : "memory");
+}
+
+static void write_end(void) {
+  asm volatile("" : : : "memory");
+  vdso_data->seq++;
+}
+
+void vdso_init(void) {
+  uint32_t frame = alloc_frame();
+  if (frame == 0) {
+    LOG_ERROR("vDSO: failed to allocate the data page");
+    return;
+  }
+
+  if (map_vdso_page(frame) != VDSO_ADDRESS) {
+    LOG_ERROR("vDSO: failed to map the data page");
+    free_frame(frame);
+    return;
+  }
+
+  vdso_data = (vdso_data_t*)phys_to_virt(frame);
+  memset(vdso_data, 0, FRAME_SIZE);
+
+  uint32_t eax, ebx, ecx, edx;
+  cpuid(CPUID_FEATURES, &eax, &ebx, &ecx, &edx);
+  vdso_data->cpu = ebx >> 24;
+
+  LOG_INFO("vDSO data page at 0x%x (frame 0x%x)", VDSO_ADDRESS, frame);
+}
+
+void vdso_update_clock(uint64_t base_cycles, uint64_t base_ns, uint32_t mult, uint32_t shift) {
+  if (vdso_data == NULL) {
+    return;
+  }
+
+  uint32_t eflags = interrupt_save();
+  write_begin();
+  vdso_data->base_cycles = base_cycles;
+  vdso_data->base_ns = base_ns;
+  vdso_data->mult = mult;
+  vdso_data->shift = shift;
+  write_end();
+  interrupt_restore(eflags);
+}
+
+void vdso_set_realtime_offset(uint64_t offset_ns) {
+  if (vdso_data == NULL) {
+    return;
+  }
+
+  uint32_t eflags = interrupt_save();
+  write_begin();
+  vdso_data->realtime_offset_ns = offset_ns;
+  write_end();
+  interrupt_restore(eflags);
+}
+
+void vdso_set_pid(uint32_t pid) {
+  if (vdso_data != NULL) {
+    vdso_data->pid = pid;
+  }
+}
@@ -0,0 +1,193 @@
+#include "sched/futex.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/uaccess.h"
+#include "lib/sys/errno.h"
+#include "mem/page_frame_allocator.h"
+#include "mem/paging.h"
+#include "mem/process.h"
+#include "sched/sched.h"
+#include "sched/wait.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Futexes. A word in a private mapping is keyed by its address space (the
+ * thread group leader) and virtual address, so COW, reclaim and KSM moving it
+ * to another frame do not matter and threads of one process meet on the same
+ * key. A word in a shared mapping is keyed by its physical address instead, so
+ * processes sharing the page meet too; shared frames are never reclaimed or
+ * merged, and a waiter holds a reference on the frame so it cannot be reused
+ * while it sleeps. Waiters sit on their kernel stacks in a hashed table of
+ * lists. As with wait queues, interrupts stay off from the value check until
+ * the waiter is blocked.
+ */
+
+typedef struct {
+  process_t* mm;
+  uint32_t addr;
+} futex_key_t;
+
+typedef struct futex_waiter {
+  process_t* proc;
+  futex_key_t key;
+  struct futex_waiter* next;
+  struct futex_waiter* prev;
+  bool queued;
+} futex_waiter_t;
+
+static futex_waiter_t* futex_hash[FUTEX_HASH_BUCKETS];
+
+static futex_waiter_t** futex_bucket(futex_key_t key) {
+  uint32_t hash = (key.addr >> 2) ^ (uint32_t)key.mm;
+  return &futex_hash[(hash * 0x9E3779B1u) >> (32 - FUTEX_HASH_BITS)];
+}
+
+static bool futex_key_equal(futex_key_t a, futex_key_t b) { return a.mm == b.mm && a.addr == b.addr; }
+
+static futex_key_t futex_key(uint32_t uaddr) {
+  uint32_t* pte = get_page_entry((uint32_t*)current_process->context.cr3, uaddr);
+  if (pte && (*pte & PAGE_PRESENT) && (*pte & PAGE_SHARED)) {
+    return (futex_key_t){NULL, (*pte & ~0xFFF) | (uaddr & 0xFFF)};
+  }
+  return (futex_key_t){current_process->leader, uaddr};
+}
+
+/* Shared keys pin their frame; private keys need nothing. */
+static void futex_key_get(futex_key_t key) {
+  if (key.mm == NULL) {
+    ref_frame(key.addr & ~0xFFF);
+  }
+}
+
+static void futex_key_put(futex_key_t key) {
+  if (key.mm == NULL) {
+    unref_frame(key.addr & ~0xFFF);
+  }
+}
+
+static bool futex_addr_valid(uint32_t uaddr) { return (uaddr & 3) == 0 && uaddr < KERNEL_VIRTUAL_START; }
+
+static void futex_link(futex_waiter_t* waiter, futex_key_t key) {
+  futex_waiter_t** head = futex_bucket(key);
+
+  waiter->key = key;
+  waiter->prev = NULL;
+  waiter->next = *head;
+  if (*head) {
+    (*head)->prev = waiter;
+  }
+  *head = waiter;
+  waiter->queued = true;
+}
+
+static void futex_unlink(futex_waiter_t* waiter) {
+  if (waiter->prev) {
+    waiter->prev->next = waiter->next;
+  } else {
+    *futex_bucket(waiter->key) = waiter->next;
+  }
+  if (waiter->next) {
+    waiter->next->prev = waiter->prev;
+  }
+  waiter->queued = false;
+}
+
+/*
+ * Sleeps while the word at uaddr holds val, until futex_wake or for at most
+ * timeout ticks (WAIT_FOREVER for no limit). Returns 0 once woken, -EAGAIN if
+ * the word had already changed, or -ETIMEDOUT.
+ */
+int futex_wait(uint32_t uaddr, uint32_t val, uint32_t timeout) {
+  if (!futex_addr_valid(uaddr)) {
+    return -EINVAL;
+  }
+
+  uint32_t eflags = interrupt_save();
+
+  /* Reading the word faults it in, so a shared page has a frame to key on. */
+  uint32_t current;
+  if (copy_from_user(&current, (const void*)uaddr, sizeof(current)) != 0) {
+    interrupt_restore(eflags);
+    return -EFAULT;
+  }
+  if (current != val) {
+    interrupt_restore(eflags);
+    return -EAGAIN;
+  }
+
+  futex_key_t key = futex_key(uaddr);
+  futex_key_get(key);
+
+  futex_waiter_t waiter = {current_process, {NULL, 0}, NULL, NULL, false};
+  futex_link(&waiter, key);
+
+  uint32_t left = timeout;
+  while (waiter.queued && left > 0) {
+    current_process->state = PROCESS_STATE_BLOCKED;
+    if (timeout == WAIT_FOREVER) {
+      schedule();
+    } else {
+      left = schedule_timeout(left, 0);
+    }
+  }
+
+  int result = 0;
+  if (waiter.queued) {
+    futex_unlink(&waiter);
+    result = -ETIMEDOUT;
+  }
+  futex_key_put(waiter.key);
+
+  interrupt_restore(eflags);
+  return result;
+}
+
+/* Wakes up to wake waiters on key and moves up to requeue more to new_key. Returns how many were handled. */
+static int futex_wake_key(futex_key_t key, uint32_t wake, futex_key_t new_key, uint32_t requeue) {
+  int handled = 0;
+  futex_waiter_t* waiter = *futex_bucket(key);
+
+  while (waiter && (wake > 0 || requeue > 0)) {
+    futex_waiter_t* next = waiter->next;
+    if (!futex_key_equal(waiter->key, key)) {
+      waiter = next;
+      continue;
+    }
+
+    futex_unlink(waiter);
+    if (wake > 0) {
+      wake--;
+      sched_wake(waiter->proc);
+    } else {
+      requeue--;
+      futex_key_get(new_key);
+      futex_key_put(key);
+      futex_link(waiter, new_key);
+    }
+    handled++;
+    waiter = next;
+  }
+  return handled;
+}
+
+/* Wakes up to count waiters on the word at uaddr. Returns how many were woken. */
+int futex_wake(uint32_t uaddr, uint32_t count) { return futex_requeue(uaddr, count, uaddr, 0); }
+
+/*
+ * Wakes up to wake waiters on the word at uaddr and moves up to requeue of the
+ * rest to wait on uaddr2 instead, so a condition variable broadcast does not
+ * wake every waiter only for them to pile up on the mutex. Returns how many
+ * waiters were woken or moved.
+ */
+int futex_requeue(uint32_t uaddr, uint32_t wake, uint32_t uaddr2, uint32_t requeue) {
+  if (!futex_addr_valid(uaddr) || !futex_addr_valid(uaddr2)) {
+    return -EINVAL;
+  }
+
+  uint32_t eflags = interrupt_save();
+
+  int result = futex_wake_key(futex_key(uaddr), wake, futex_key(uaddr2), requeue);
+
+  interrupt_restore(eflags);
+  return result;
+}
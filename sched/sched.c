@@ -0,0 +1,669 @@
+#include "sched/sched.h"
+#include "arch/x86/gdt.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/timer.h"
+#include "arch/x86/tss.h"
+#include "lib/log.h"
+#include "lib/sys/errno.h"
+#include "mem/process.h"
+#include "mem/vdso.h"
+#include "sched/timer_wheel.h"
+#include <stddef.h>
+
+/*
+ * O(1) scheduler. Runnable processes sit on per-priority FIFOs in the active
+ * array and a bitmap of non-empty levels makes pick-next a find-first-set.
+ * A process that uses up its timeslice moves to the expired array, and the
+ * arrays swap once the active one drains, so every process runs once per
+ * epoch. Sleepers earn a priority bonus and interactive ones go straight back
+ * to the active array unless the expired array has waited too long.
+ *
+ * SCHED_DEADLINE processes sit above all of that on an EDF queue sorted by
+ * absolute deadline. Each gets dl_runtime ticks per dl_period; once the
+ * budget is spent it is throttled until the next period starts, so an overrun
+ * cannot eat into other reservations. Admission keeps the summed bandwidth
+ * below SCHED_DL_MAX_BW.
+ *
+ * The timer only fires when the next of those events is due: the running
+ * process's timeslice or budget ending, a throttled process's next period, or
+ * the earliest timer on the timer wheel.
+ * sched_tick may therefore be charged several ticks at once.
+ *
+ * Kernel code is not preemptible: every IDT gate is a trap gate, so IF stays
+ * set in the kernel, and the heap, frame allocator and process lists take no
+ * locks. A tick that wants another process only sets need_resched, and the
+ * switch happens when the interrupted process is about to return to user
+ * mode. Kernel tasks run until they block or yield.
+ */
+
+typedef struct sched_prio_array {
+  uint32_t nr_active;
+  uint32_t bitmap[SCHED_BITMAP_WORDS];
+  process_t* head[SCHED_PRIORITIES];
+  process_t* tail[SCHED_PRIORITIES];
+} prio_array_t;
+
+static prio_array_t arrays[2];
+static prio_array_t* active = &arrays[0];
+static prio_array_t* expired = &arrays[1];
+static uint32_t expired_since = 0;
+static uint32_t jiffies = 0;
+static uint32_t context_switches = 0;
+static bool need_resched = false;
+
+static process_t* dl_queue = NULL;
+static process_t* dl_tasks[SCHED_DL_MAX_TASKS];
+static uint32_t dl_total_bw = 0;
+
+/* The boot context becomes the idle task; it runs whenever current_process is NULL. */
+static uint32_t idle_kernel_esp = 0;
+static uint32_t idle_cr3 = 0;
+
+extern void switch_stacks(uint32_t* prev_esp, uint32_t next_esp);
+
+void sched_init(void) {
+  active = &arrays[0];
+  expired = &arrays[1];
+  asm volatile("mov %%cr3, %0" : "=r"(idle_cr3));
+
+  LOG_INFO("Scheduler initialized (%d priority levels)", SCHED_PRIORITIES);
+}
+
+static void enqueue_array(prio_array_t* array, process_t* proc) {
+  int prio = proc->sched.prio;
+
+  proc->next_in_ready_queue = NULL;
+  if (array->tail[prio] != NULL) {
+    array->tail[prio]->next_in_ready_queue = proc;
+  } else {
+    array->head[prio] = proc;
+    array->bitmap[prio / 32] |= 1u << (prio % 32);
+  }
+  array->tail[prio] = proc;
+  array->nr_active++;
+  proc->sched.array = array;
+}
+
+static void dequeue_array(prio_array_t* array, process_t* proc) {
+  int prio = proc->sched.prio;
+  process_t* prev = NULL;
+
+  for (process_t* p = array->head[prio]; p != NULL; prev = p, p = p->next_in_ready_queue) {
+    if (p != proc) {
+      continue;
+    }
+
+    if (prev != NULL) {
+      prev->next_in_ready_queue = p->next_in_ready_queue;
+    } else {
+      array->head[prio] = p->next_in_ready_queue;
+    }
+    if (array->tail[prio] == p) {
+      array->tail[prio] = prev;
+    }
+    if (array->head[prio] == NULL) {
+      array->bitmap[prio / 32] &= ~(1u << (prio % 32));
+    }
+    array->nr_active--;
+    break;
+  }
+
+  proc->next_in_ready_queue = NULL;
+  proc->sched.array = NULL;
+}
+
+static int first_prio(prio_array_t* array) {
+  for (int i = 0; i < SCHED_BITMAP_WORDS; i++) {
+    if (array->bitmap[i] != 0) {
+      return i * 32 + __builtin_ctz(array->bitmap[i]);
+    }
+  }
+  return -1;
+}
+
+static int sleep_bonus(process_t* proc) {
+  return (int)(proc->sched.sleep_avg * SCHED_MAX_BONUS / SCHED_MAX_SLEEP_AVG) - SCHED_MAX_BONUS / 2;
+}
+
+static int effective_prio(process_t* proc) {
+  int prio = proc->sched.static_prio - sleep_bonus(proc);
+  if (prio < 0) {
+    return 0;
+  }
+  if (prio >= SCHED_PRIORITIES) {
+    return SCHED_PRIORITIES - 1;
+  }
+  return prio;
+}
+
+/* Scales linearly from SCHED_MAX_TIMESLICE at nice -20 down to SCHED_MIN_TIMESLICE at nice 19. */
+static uint32_t task_timeslice(process_t* proc) {
+  return SCHED_MIN_TIMESLICE + (SCHED_MAX_TIMESLICE - SCHED_MIN_TIMESLICE) *
+                                   (SCHED_PRIORITIES - 1 - proc->sched.static_prio) / (SCHED_PRIORITIES - 1);
+}
+
+static bool expired_starving(void) {
+  return expired->nr_active > 0 && jiffies - expired_since > SCHED_STARVATION_LIMIT;
+}
+
+static bool deadline_before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+static bool is_deadline(process_t* proc) { return proc->sched.policy == SCHED_DEADLINE; }
+
+static void dl_enqueue(process_t* proc) {
+  process_t** link = &dl_queue;
+  while (*link != NULL && !deadline_before(proc->sched.dl_abs_deadline, (*link)->sched.dl_abs_deadline)) {
+    link = &(*link)->next_in_ready_queue;
+  }
+
+  proc->next_in_ready_queue = *link;
+  *link = proc;
+  proc->sched.dl_queued = true;
+}
+
+static void dl_dequeue(process_t* proc) {
+  for (process_t** link = &dl_queue; *link != NULL; link = &(*link)->next_in_ready_queue) {
+    if (*link == proc) {
+      *link = proc->next_in_ready_queue;
+      break;
+    }
+  }
+
+  proc->next_in_ready_queue = NULL;
+  proc->sched.dl_queued = false;
+}
+
+/* Starts a new period: full budget and a deadline dl_deadline ticks from its start. */
+static void dl_replenish(process_t* proc, uint32_t period_start) {
+  proc->sched.dl_remaining = proc->sched.dl_runtime;
+  proc->sched.dl_abs_deadline = period_start + proc->sched.dl_deadline;
+  proc->sched.dl_next_period = period_start + proc->sched.dl_period;
+  proc->sched.dl_throttled = false;
+}
+
+/* Unthrottles processes whose next period has begun. Returns true if any became runnable. */
+static bool dl_replenish_due(void) {
+  bool queued = false;
+
+  for (int i = 0; i < SCHED_DL_MAX_TASKS; i++) {
+    process_t* proc = dl_tasks[i];
+    if (proc == NULL || !proc->sched.dl_throttled || deadline_before(jiffies, proc->sched.dl_next_period)) {
+      continue;
+    }
+
+    dl_replenish(proc, proc->sched.dl_next_period);
+    if (proc->state == PROCESS_STATE_READY) {
+      dl_enqueue(proc);
+      queued = true;
+    }
+  }
+  return queued;
+}
+
+static uint32_t ms_to_ticks(uint32_t ms) {
+  uint32_t ticks = (ms + PIT_TICK_MS - 1) / PIT_TICK_MS;
+  return ticks ? ticks : 1;
+}
+
+/* Ticks since boot, including those the armed one-shot has not reported yet. */
+uint32_t sched_clock(void) { return jiffies + timer_ticks_pending(); }
+
+static bool has_runnable(void) { return dl_queue != NULL || active->nr_active > 0 || expired->nr_active > 0; }
+
+/* Ticks until the scheduler next needs to run, or 0 if nothing is pending. */
+static uint32_t next_event(void) {
+  process_t* proc = current_process;
+  uint32_t next = 0;
+
+  if (proc == NULL) {
+    if (has_runnable()) {
+      return 1;
+    }
+  } else if (is_deadline(proc)) {
+    next = proc->sched.dl_remaining;
+  } else if (has_runnable()) {
+    next = proc->sched.timeslice;
+  }
+
+  for (int i = 0; i < SCHED_DL_MAX_TASKS; i++) {
+    process_t* task = dl_tasks[i];
+    if (task == NULL || !task->sched.dl_throttled) {
+      continue;
+    }
+
+    uint32_t until = deadline_before(jiffies, task->sched.dl_next_period) ? task->sched.dl_next_period - jiffies : 1;
+    if (next == 0 || until < next) {
+      next = until;
+    }
+  }
+
+  uint32_t timer = timer_wheel_next(sched_clock());
+  if (timer != 0 && (next == 0 || timer < next)) {
+    next = timer;
+  }
+  return next;
+}
+
+static void dl_detach(process_t* proc) {
+  for (int i = 0; i < SCHED_DL_MAX_TASKS; i++) {
+    if (dl_tasks[i] == proc) {
+      dl_tasks[i] = NULL;
+    }
+  }
+  if (proc->sched.dl_queued) {
+    dl_dequeue(proc);
+  }
+
+  dl_total_bw -= proc->sched.dl_bw;
+  proc->sched.dl_bw = 0;
+  proc->sched.dl_throttled = false;
+  proc->sched.policy = SCHED_NORMAL;
+}
+
+void sched_init_task(process_t* proc, int nice) {
+  proc->sched.static_prio = SCHED_NICE_TO_PRIO(nice);
+  proc->sched.prio = proc->sched.static_prio;
+  proc->sched.timeslice = task_timeslice(proc);
+  proc->sched.sleep_avg = 0;
+  proc->sched.sleep_start = 0;
+  proc->sched.array = NULL;
+  proc->sched.policy = SCHED_NORMAL;
+  proc->sched.dl_bw = 0;
+  proc->sched.dl_throttled = false;
+  proc->sched.dl_queued = false;
+}
+
+static bool should_preempt(process_t* proc) {
+  if (is_deadline(proc)) {
+    return proc->sched.dl_throttled ||
+           (dl_queue != NULL && deadline_before(dl_queue->sched.dl_abs_deadline, proc->sched.dl_abs_deadline));
+  }
+  if (dl_queue != NULL || proc->sched.timeslice == 0) {
+    return true;
+  }
+
+  int best = first_prio(active);
+  return best >= 0 && best < proc->sched.prio;
+}
+
+/* A wakeup that beats the running process takes the CPU at its next return to user mode. */
+static void check_preempt_wakeup(process_t* woken) {
+  process_t* proc = current_process;
+  if (proc != NULL && proc != woken && proc->state == PROCESS_STATE_RUNNING && should_preempt(proc)) {
+    need_resched = true;
+  }
+}
+
+void sched_enqueue(process_t* proc) {
+  uint32_t eflags = interrupt_save();
+
+  proc->state = PROCESS_STATE_READY;
+  if (is_deadline(proc)) {
+    if (!proc->sched.dl_throttled) {
+      dl_enqueue(proc);
+      check_preempt_wakeup(proc);
+    }
+    timer_request_tick(next_event());
+    interrupt_restore(eflags);
+    return;
+  }
+
+  proc->sched.prio = effective_prio(proc);
+  if (proc->sched.timeslice == 0) {
+    proc->sched.timeslice = task_timeslice(proc);
+  }
+  enqueue_array(active, proc);
+  check_preempt_wakeup(proc);
+  timer_request_tick(next_event());
+
+  interrupt_restore(eflags);
+}
+
+void sched_wake(process_t* proc) {
+  if (proc->state != PROCESS_STATE_BLOCKED) {
+    return;
+  }
+
+  /* A deadline process waking past its deadline, or with more budget left than fits before it, starts a new period. */
+  if (is_deadline(proc) && !proc->sched.dl_throttled) {
+    uint32_t left = proc->sched.dl_abs_deadline - jiffies;
+    if (!deadline_before(jiffies, proc->sched.dl_abs_deadline) ||
+        (uint64_t)proc->sched.dl_remaining * proc->sched.dl_period > (uint64_t)left * proc->sched.dl_runtime) {
+      dl_replenish(proc, jiffies);
+    }
+  }
+
+  uint32_t slept = jiffies - proc->sched.sleep_start;
+  proc->sched.sleep_avg += slept;
+  if (proc->sched.sleep_avg > SCHED_MAX_SLEEP_AVG) {
+    proc->sched.sleep_avg = SCHED_MAX_SLEEP_AVG;
+  }
+
+  sched_enqueue(proc);
+}
+
+/* Puts a process that is still runnable back on a runqueue after it gave up the CPU. */
+static void requeue(process_t* proc) {
+  proc->state = PROCESS_STATE_READY;
+  if (is_deadline(proc)) {
+    if (!proc->sched.dl_throttled) {
+      dl_enqueue(proc);
+    }
+    return;
+  }
+
+  if (proc->sched.timeslice > 0) {
+    enqueue_array(active, proc);
+    return;
+  }
+
+  proc->sched.prio = effective_prio(proc);
+  proc->sched.timeslice = task_timeslice(proc);
+  if (sleep_bonus(proc) >= SCHED_INTERACTIVE_BONUS && !expired_starving()) {
+    enqueue_array(active, proc);
+    return;
+  }
+
+  if (expired->nr_active == 0) {
+    expired_since = jiffies;
+  }
+  enqueue_array(expired, proc);
+}
+
+static process_t* pick_next(void) {
+  if (dl_queue != NULL) {
+    process_t* next = dl_queue;
+    dl_dequeue(next);
+    return next;
+  }
+
+  if (active->nr_active == 0 && expired->nr_active > 0) {
+    prio_array_t* swap = active;
+    active = expired;
+    expired = swap;
+  }
+
+  int prio = first_prio(active);
+  if (prio < 0) {
+    return NULL;
+  }
+
+  process_t* next = active->head[prio];
+  dequeue_array(active, next);
+  return next;
+}
+
+/* Saves prev's callee-saved registers, kernel stack and %gs, then resumes next where it last switched out. */
+static void switch_to(process_t* prev, process_t* next) {
+  uint32_t* prev_esp = prev ? &prev->kernel_esp : &idle_kernel_esp;
+  uint32_t prev_cr3 = prev ? prev->context.cr3 : idle_cr3;
+  uint32_t next_esp = idle_kernel_esp;
+  uint32_t next_cr3 = idle_cr3;
+  uint32_t next_gs = 0;
+
+  if (prev) {
+    prev->gs = read_gs();
+  }
+  if (next) {
+    tss_set_kernel_stack((uint32_t)next->kstack + PROCESS_KERNEL_STACK_SIZE);
+    gdt_set_tls_base(next->tls_base);
+    next_esp = next->kernel_esp;
+    next_cr3 = next->context.cr3;
+    next_gs = next->gs;
+  }
+
+  context_switches++;
+  /* getpid() reports the process, so threads publish their leader's PID. */
+  vdso_set_pid(next ? next->leader->pid : 0);
+  /* Threads of one process share a page directory, so switching between them keeps the TLB. */
+  if (next_cr3 != prev_cr3) {
+    asm volatile("mov %0, %%cr3" : : "r"(next_cr3) : "memory");
+  }
+  write_gs(next_gs);
+  switch_stacks(prev_esp, next_esp);
+}
+
+/*
+ * Runs the best runnable process. A still-running current process is
+ * requeued, a blocked one starts accruing sleep time and a terminated one is
+ * dropped. With nothing runnable the CPU returns to the idle task. Returns
+ * once the caller is scheduled again.
+ */
+void schedule(void) {
+  uint32_t eflags = interrupt_save();
+  process_t* prev = current_process;
+  need_resched = false;
+
+  if (prev && prev->state == PROCESS_STATE_RUNNING) {
+    bool throttled = is_deadline(prev) && prev->sched.dl_throttled;
+    if (!throttled && dl_queue == NULL && active->nr_active == 0 && expired->nr_active == 0) {
+      if (prev->sched.timeslice == 0) {
+        prev->sched.prio = effective_prio(prev);
+        prev->sched.timeslice = task_timeslice(prev);
+      }
+      timer_request_tick(next_event());
+      interrupt_restore(eflags);
+      return;
+    }
+    requeue(prev);
+  } else if (prev && prev->state == PROCESS_STATE_BLOCKED) {
+    prev->sched.sleep_start = jiffies;
+  }
+
+  process_t* next = pick_next();
+  if (next == NULL && prev == NULL) {
+    timer_request_tick(next_event());
+    interrupt_restore(eflags);
+    return;
+  }
+
+  if (next) {
+    next->state = PROCESS_STATE_RUNNING;
+    LOG_DEBUG("Switching from PID %d to PID %d (prio %d, slice %d)", prev ? prev->pid : 0, next->pid,
+              next->sched.prio, next->sched.timeslice);
+  }
+
+  current_process = next;
+  timer_request_tick(next_event());
+  if (next != prev) {
+    switch_to(prev, next);
+  }
+
+  interrupt_restore(eflags);
+}
+
+static uint32_t charge(uint32_t* counter, uint32_t ticks) {
+  uint32_t charged = *counter < ticks ? *counter : ticks;
+  *counter -= charged;
+  return charged;
+}
+
+/*
+ * Called from the PIT with the ticks that passed since the last call: charges
+ * the running process and marks it for preemption when its budget ends or a
+ * better one waits. The idle task is only ever interrupted in its hlt loop, so
+ * it is switched away from directly.
+ */
+void sched_tick(uint32_t ticks) {
+  uint32_t eflags = interrupt_save();
+  process_t* proc = current_process;
+  jiffies += ticks;
+
+  bool replenished = dl_replenish_due();
+  timer_wheel_advance(jiffies);
+
+  if (proc == NULL) {
+    interrupt_restore(eflags);
+    if (replenished || has_runnable()) {
+      schedule();
+    } else {
+      timer_request_tick(next_event());
+    }
+    return;
+  }
+
+  if (is_deadline(proc)) {
+    if (charge(&proc->sched.dl_remaining, ticks) > 0 && proc->sched.dl_remaining == 0) {
+      proc->sched.dl_throttled = true;
+    }
+  } else {
+    charge(&proc->sched.sleep_avg, ticks);
+    charge(&proc->sched.timeslice, ticks);
+  }
+
+  if (should_preempt(proc)) {
+    need_resched = true;
+  } else {
+    timer_request_tick(next_event());
+  }
+  interrupt_restore(eflags);
+}
+
+/* Called on every return to user mode, where the interrupted process holds no kernel state. */
+void sched_return_to_user(void) {
+  if (need_resched) {
+    schedule();
+  }
+}
+
+int sched_set_nice(process_t* proc, int nice) {
+  if (nice < SCHED_NICE_MIN) {
+    nice = SCHED_NICE_MIN;
+  } else if (nice > SCHED_NICE_MAX) {
+    nice = SCHED_NICE_MAX;
+  }
+
+  uint32_t eflags = interrupt_save();
+  prio_array_t* array = proc->sched.array;
+  if (array != NULL) {
+    dequeue_array(array, proc);
+  }
+
+  proc->sched.static_prio = SCHED_NICE_TO_PRIO(nice);
+  proc->sched.prio = effective_prio(proc);
+
+  if (array != NULL) {
+    enqueue_array(array, proc);
+  }
+  interrupt_restore(eflags);
+
+  return nice;
+}
+
+int sched_get_nice(process_t* proc) { return SCHED_PRIO_TO_NICE(proc->sched.static_prio); }
+
+uint32_t sched_context_switches(void) { return context_switches; }
+
+/*
+ * Moves proc to SCHED_DEADLINE with the given reservation, or back to the
+ * normal class when runtime_ms is 0. Fails with -EBUSY if admitting it would
+ * overcommit the CPU.
+ */
+int sched_setattr(process_t* proc, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms) {
+  uint32_t eflags = interrupt_save();
+
+  if (runtime_ms == 0) {
+    if (is_deadline(proc)) {
+      /* A READY task is off every queue once detached, whether it was queued or throttled. */
+      dl_detach(proc);
+      if (proc->state == PROCESS_STATE_READY) {
+        sched_enqueue(proc);
+      }
+    }
+    interrupt_restore(eflags);
+    return 0;
+  }
+
+  uint32_t runtime = ms_to_ticks(runtime_ms);
+  uint32_t deadline = ms_to_ticks(deadline_ms);
+  uint32_t period = ms_to_ticks(period_ms);
+  if (runtime > deadline || deadline > period) {
+    interrupt_restore(eflags);
+    return -EINVAL;
+  }
+
+  uint32_t bw = (runtime << 16) / period;
+  if (dl_total_bw - proc->sched.dl_bw + bw > SCHED_DL_MAX_BW) {
+    interrupt_restore(eflags);
+    LOG_WARN("sched: PID %d deadline reservation %d/%d ticks rejected", proc->pid, runtime, period);
+    return -EBUSY;
+  }
+
+  int slot = -1;
+  for (int i = 0; i < SCHED_DL_MAX_TASKS; i++) {
+    if (dl_tasks[i] == proc) {
+      slot = i;
+      break;
+    }
+    if (dl_tasks[i] == NULL && slot < 0) {
+      slot = i;
+    }
+  }
+  if (slot < 0) {
+    interrupt_restore(eflags);
+    return -EBUSY;
+  }
+
+  if (proc->sched.array != NULL) {
+    dequeue_array(proc->sched.array, proc);
+  }
+  if (proc->sched.dl_queued) {
+    dl_dequeue(proc);
+  }
+
+  dl_tasks[slot] = proc;
+  dl_total_bw = dl_total_bw - proc->sched.dl_bw + bw;
+  proc->sched.policy = SCHED_DEADLINE;
+  proc->sched.dl_runtime = runtime;
+  proc->sched.dl_deadline = deadline;
+  proc->sched.dl_period = period;
+  proc->sched.dl_bw = bw;
+  dl_replenish(proc, jiffies);
+
+  if (proc->state == PROCESS_STATE_READY) {
+    sched_enqueue(proc);
+  }
+  interrupt_restore(eflags);
+
+  LOG_INFO("sched: PID %d runs SCHED_DEADLINE %d/%d/%d ticks", proc->pid, runtime, deadline, period);
+  return 0;
+}
+
+/* Gives up the CPU; a deadline process also gives up the rest of its budget until its next period. */
+void sched_yield(void) {
+  process_t* proc = current_process;
+  if (proc && is_deadline(proc)) {
+    proc->sched.dl_remaining = 0;
+    proc->sched.dl_throttled = true;
+  }
+  schedule();
+}
+
+void sched_task_exit(process_t* proc) {
+  uint32_t eflags = interrupt_save();
+  if (is_deadline(proc)) {
+    dl_detach(proc);
+  }
+  interrupt_restore(eflags);
+}
+
+static void wake_timeout(void* arg) { sched_wake(arg); }
+
+/*
+ * Sleeps the current process, which the caller has marked blocked, until
+ * sched_wake or until ticks have passed, up to slack ticks late. Returns the
+ * ticks that were left, 0 if it timed out.
+ */
+uint32_t schedule_timeout(uint32_t ticks, uint32_t slack) {
+  wheel_timer_t timer;
+  uint32_t expires = sched_clock() + ticks;
+
+  timer_wheel_init_timer(&timer, wake_timeout, current_process);
+  timer_wheel_add(&timer, expires, slack);
+  schedule();
+  timer_wheel_cancel(&timer);
+
+  uint32_t now = sched_clock();
+  return deadline_before(now, expires) ? expires - now : 0;
+}
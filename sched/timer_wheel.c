@@ -0,0 +1,173 @@
+#include "sched/timer_wheel.h"
+#include "arch/x86/interrupt.h"
+#include <stddef.h>
+
+/*
+ * Hierarchical timer wheel in scheduler ticks. A timer due within
+ * WHEEL_ROOT_SIZE ticks sits in the root slot for its exact tick; later ones
+ * sit in a coarser outer level and are cascaded one level inwards each time
+ * the level below wraps. Insert and cancel only touch one slot list, so
+ * thousands of pending timers cost nothing until they come due.
+ */
+
+static wheel_timer_t* root[WHEEL_ROOT_SIZE];
+static wheel_timer_t* levels[WHEEL_LEVELS][WHEEL_LEVEL_SIZE];
+static uint32_t wheel_jiffies = 0;
+static uint32_t pending_timers = 0;
+
+static uint32_t level_index(int level, uint32_t jiffies) {
+  return (jiffies >> (WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS)) & (WHEEL_LEVEL_SIZE - 1);
+}
+
+static wheel_timer_t** slot_for(uint32_t expires) {
+  uint32_t delta = expires - wheel_jiffies;
+
+  if ((int32_t)delta < 0) {
+    return &root[wheel_jiffies & (WHEEL_ROOT_SIZE - 1)];
+  }
+  if (delta < WHEEL_ROOT_SIZE) {
+    return &root[expires & (WHEEL_ROOT_SIZE - 1)];
+  }
+  for (int level = 0; level < WHEEL_LEVELS - 1; level++) {
+    if (delta < 1u << (WHEEL_ROOT_BITS + (level + 1) * WHEEL_LEVEL_BITS)) {
+      return &levels[level][level_index(level, expires)];
+    }
+  }
+  return &levels[WHEEL_LEVELS - 1][level_index(WHEEL_LEVELS - 1, expires)];
+}
+
+static void link(wheel_timer_t* timer) {
+  wheel_timer_t** slot = slot_for(timer->expires);
+
+  timer->slot = slot;
+  timer->prev = NULL;
+  timer->next = *slot;
+  if (*slot) {
+    (*slot)->prev = timer;
+  }
+  *slot = timer;
+}
+
+static void unlink(wheel_timer_t* timer) {
+  if (timer->prev) {
+    timer->prev->next = timer->next;
+  } else {
+    *timer->slot = timer->next;
+  }
+  if (timer->next) {
+    timer->next->prev = timer->prev;
+  }
+  timer->slot = NULL;
+}
+
+/* Rounds expires up within its slack to a boundary with as many low zero bits as possible, so timers coalesce. */
+static uint32_t apply_slack(uint32_t expires, uint32_t slack) {
+  uint32_t limit = expires + slack;
+  uint32_t mask = expires ^ limit;
+  if (slack == 0 || mask == 0) {
+    return expires;
+  }
+
+  uint32_t bit = 31 - __builtin_clz(mask);
+  return limit & ~((1u << bit) - 1);
+}
+
+void timer_wheel_init_timer(wheel_timer_t* timer, wheel_timer_fn_t fn, void* arg) {
+  timer->next = NULL;
+  timer->prev = NULL;
+  timer->slot = NULL;
+  timer->expires = 0;
+  timer->fn = fn;
+  timer->arg = arg;
+}
+
+/* Arms the timer to fire on tick expires, or up to slack ticks later if that lets it share a wakeup. */
+void timer_wheel_add(wheel_timer_t* timer, uint32_t expires, uint32_t slack) {
+  uint32_t eflags = interrupt_save();
+  if (timer->slot) {
+    unlink(timer);
+    pending_timers--;
+  }
+
+  timer->expires = apply_slack(expires, slack);
+  link(timer);
+  pending_timers++;
+  interrupt_restore(eflags);
+}
+
+/* Returns true if the timer was still pending. */
+bool timer_wheel_cancel(wheel_timer_t* timer) {
+  uint32_t eflags = interrupt_save();
+  bool pending = timer->slot != NULL;
+  if (pending) {
+    unlink(timer);
+    pending_timers--;
+  }
+  interrupt_restore(eflags);
+  return pending;
+}
+
+bool timer_wheel_pending(wheel_timer_t* timer) { return timer->slot != NULL; }
+
+/* Moves every timer in one outer slot to the level its expiry now falls in. Returns the slot index. */
+static uint32_t cascade(int level) {
+  uint32_t index = level_index(level, wheel_jiffies);
+  wheel_timer_t* timer = levels[level][index];
+
+  levels[level][index] = NULL;
+  while (timer) {
+    wheel_timer_t* next = timer->next;
+    link(timer);
+    timer = next;
+  }
+  return index;
+}
+
+/* Called from the timer interrupt: fires every timer due up to and including tick now. */
+void timer_wheel_advance(uint32_t now) {
+  if (pending_timers == 0) {
+    wheel_jiffies = now + 1;
+    return;
+  }
+
+  while ((int32_t)(now - wheel_jiffies) >= 0) {
+    uint32_t index = wheel_jiffies & (WHEEL_ROOT_SIZE - 1);
+    if (index == 0) {
+      for (int level = 0; level < WHEEL_LEVELS && cascade(level) == 0; level++) {
+      }
+    }
+    wheel_jiffies++;
+
+    while (root[index]) {
+      wheel_timer_t* timer = root[index];
+      unlink(timer);
+      pending_timers--;
+      timer->fn(timer->arg);
+    }
+  }
+}
+
+/*
+ * Ticks from now until the scheduler has to run the wheel, or 0 with no
+ * timers pending. Timers in the outer levels only report when their level
+ * next cascades, which is never later than their expiry.
+ */
+uint32_t timer_wheel_next(uint32_t now) {
+  if (pending_timers == 0) {
+    return 0;
+  }
+
+  uint32_t index = wheel_jiffies & (WHEEL_ROOT_SIZE - 1);
+  uint32_t ahead = WHEEL_ROOT_SIZE - index;
+  for (uint32_t i = 0; i < WHEEL_ROOT_SIZE; i++) {
+    if (root[(index + i) & (WHEEL_ROOT_SIZE - 1)]) {
+      ahead = i;
+      break;
+    }
+  }
+
+  uint32_t due = wheel_jiffies + ahead;
+  return (int32_t)(due - now) > 0 ? due - now : 1;
+}
+
+uint32_t timer_wheel_count(void) { return pending_timers; }
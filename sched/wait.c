@@ -0,0 +1,104 @@
+#include "sched/wait.h"
+#include "arch/x86/interrupt.h"
+#include "lib/sys/errno.h"
+#include "mem/process.h"
+#include "sched/sched.h"
+#include <stddef.h>
+
+/*
+ * Wait queues. A sleeper queues an entry on its own kernel stack, blocks and
+ * re-checks its condition every time it is woken, so a waker only has to
+ * change the state and wake the queue. Waking takes the entry off the queue,
+ * which lets wake_up_one hand each wakeup to a different sleeper in FIFO
+ * order. Interrupts stay off from the condition check until the process is
+ * blocked, so a wakeup from an interrupt cannot slip in between.
+ */
+
+void wait_queue_init(wait_queue_t* wq) {
+  wq->head = NULL;
+  wq->tail = NULL;
+}
+
+static void enqueue(wait_queue_t* wq, wait_queue_entry_t* entry) {
+  entry->next = NULL;
+  entry->queued = true;
+  if (wq->tail) {
+    wq->tail->next = entry;
+  } else {
+    wq->head = entry;
+  }
+  wq->tail = entry;
+}
+
+static void dequeue(wait_queue_t* wq, wait_queue_entry_t* entry) {
+  wait_queue_entry_t* prev = NULL;
+  for (wait_queue_entry_t* cur = wq->head; cur; prev = cur, cur = cur->next) {
+    if (cur != entry) {
+      continue;
+    }
+
+    if (prev) {
+      prev->next = cur->next;
+    } else {
+      wq->head = cur->next;
+    }
+    if (wq->tail == cur) {
+      wq->tail = prev;
+    }
+    break;
+  }
+  entry->queued = false;
+}
+
+/*
+ * Sleeps the current process on wq until cond(arg) holds, for at most timeout
+ * ticks (WAIT_FOREVER for no limit). Returns 0 once the condition holds or
+ * -ETIMEDOUT.
+ */
+int wait_event(wait_queue_t* wq, wait_cond_t cond, void* arg, uint32_t timeout) {
+  wait_queue_entry_t entry = {current_process, NULL, false};
+  uint32_t left = timeout;
+  int result = 0;
+
+  uint32_t eflags = interrupt_save();
+  while (!cond(arg)) {
+    if (left == 0) {
+      result = -ETIMEDOUT;
+      break;
+    }
+
+    enqueue(wq, &entry);
+    current_process->state = PROCESS_STATE_BLOCKED;
+    if (timeout == WAIT_FOREVER) {
+      schedule();
+    } else {
+      left = schedule_timeout(left, 0);
+    }
+    if (entry.queued) {
+      dequeue(wq, &entry);
+    }
+  }
+  interrupt_restore(eflags);
+
+  return result;
+}
+
+void wake_up_one(wait_queue_t* wq) {
+  uint32_t eflags = interrupt_save();
+  wait_queue_entry_t* entry = wq->head;
+  if (entry) {
+    dequeue(wq, entry);
+    sched_wake(entry->proc);
+  }
+  interrupt_restore(eflags);
+}
+
+void wake_up_all(wait_queue_t* wq) {
+  uint32_t eflags = interrupt_save();
+  while (wq->head) {
+    wait_queue_entry_t* entry = wq->head;
+    dequeue(wq, entry);
+    sched_wake(entry->proc);
+  }
+  interrupt_restore(eflags);
+}
@@ -8,6 +8,9 @@
 #define INITRD_MAGIC 0xBF
 #define MAX_FILES 64
 #define MAX_PATH 256
+#define PAGE_SIZE 4096
+#define SIGNATURE_SIZE 8
+#define DATA_START (SIGNATURE_SIZE + (long)sizeof(initrd_header_t))
 
 typedef enum {
     FS_TYPE_FILE = 0,
@@ -39,6 +42,15 @@ typedef struct {
     initrd_file_header_t files[MAX_FILES];
 } initrd_header_t;
 
+/* File data starts on a page boundary so the kernel can map it into user space without copying. */
+static void pad_to_page(FILE* output) {
+    long pos = ftell(output);
+    while (pos % PAGE_SIZE != 0) {
+        fputc(0, output);
+        pos++;
+    }
+}
+
 void add_file(initrd_header_t* header, FILE* output, const char* filename, const char* filepath) {
     FILE* input = fopen(filepath, "rb");
     if (!input) {
@@ -57,18 +69,14 @@ void add_file(initrd_header_t* header, FILE* output, const char* filename, const
     header->files[header->num_files].type = FS_TYPE_FILE;
     header->files[header->num_files].permissions = FS_PERM_READ;
 
-    uint32_t offset = 0;
-    for (uint32_t i = 0; i < header->num_files; i++) {
-        offset += header->files[i].size;
-    }
-    header->files[header->num_files].offset = offset;
+    fseek(output, 0, SEEK_END);
+    pad_to_page(output);
 
     long file_pos = ftell(output);
+    header->files[header->num_files].offset = (uint32_t)(file_pos - DATA_START);
 
     header->num_files++;
 
-    fseek(output, 0, SEEK_END);
-
     uint8_t buffer[1024];
     size_t bytes_read;
     while ((bytes_read = fread(buffer, 1, sizeof(buffer), input)) > 0) {
@@ -76,6 +84,8 @@ void add_file(initrd_header_t* header, FILE* output, const char* filename, const
     }
 
     fclose(input);
+
+    pad_to_page(output);
 }
 
 int main(int argc, char** argv) {
@@ -95,13 +105,11 @@ int main(int argc, char** argv) {
     header.magic = INITRD_MAGIC;
     header.num_files = 0;
 
-    char signature[8] = "INITRD\0\0";
-    fwrite(signature, 1, 8, output);
+    char signature[SIGNATURE_SIZE] = "INITRD\0\0";
+    fwrite(signature, 1, SIGNATURE_SIZE, output);
 
     fwrite(&header, sizeof(header), 1, output);
 
-    long data_pos = ftell(output);
-
     for (int i = 2; i < argc; i++) {
         char* filepath = argv[i];
         char* filename = strrchr(filepath, '/');
@@ -115,7 +123,7 @@ int main(int argc, char** argv) {
         add_file(&header, output, filename, filepath);
     }
 
-    fseek(output, 8, SEEK_SET);
+    fseek(output, SIGNATURE_SIZE, SEEK_SET);
     fwrite(&header, sizeof(header), 1, output);
 
     fclose(output);